@@ -0,0 +1,348 @@
+#include "allocator.h"
+
+#define dDOUBLE
+#include <ode/ode.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include <sys/mman.h>
+
+namespace
+{
+
+// Every block starts with a header that says where it came from, so freeing does not depend on the size ODE passes
+// to the free handler. It also keeps the user pointer 16 byte aligned like malloc's.
+struct BlockHeader
+{
+    uint32_t SizeClass;  // LARGE_BLOCK for blocks from malloc
+    uint32_t Reserved;
+    uint64_t Size;       // requested size
+};
+
+const uint32_t LARGE_BLOCK = 0xffffffff;
+
+// Size classes are powers of two from 32 to MAX_POOLED_ALLOCATION bytes including the header
+const size_t MIN_CLASS_SHIFT = 5;
+const size_t NUM_SIZE_CLASSES = 12;
+
+struct FreeBlock
+{
+    FreeBlock* Next;
+};
+
+struct ThreadCache
+{
+    FreeBlock* Free[NUM_SIZE_CLASSES];
+    unsigned char* Chunk;  // unused part of the chunk this thread currently carves from
+    size_t ChunkLeft;
+
+    // Hands the free blocks and the rest of the chunk to the threads that are still running
+    ~ThreadCache();
+};
+
+// Zero initialized, no constructor runs at thread start. The destructor runs when a thread that allocated exits.
+thread_local ThreadCache cache;
+
+AllocConfig config;
+std::atomic<bool> installed(false);
+
+// Chunks allocated by the reservation at install time that no thread has taken yet
+std::mutex reserve_mutex;
+std::vector<unsigned char*> reserve;
+
+// Free blocks left behind by threads that have exited, one list per size class. A bit in orphan_classes is set while
+// that list is not empty, so a thread only takes the lock if there is something to take.
+std::mutex orphan_mutex;
+FreeBlock* orphans[NUM_SIZE_CLASSES];
+std::atomic<uint32_t> orphan_classes(0);
+
+std::atomic<uint64_t> num_allocs(0);
+std::atomic<uint64_t> num_frees(0);
+std::atomic<uint64_t> num_reallocs(0);
+std::atomic<uint64_t> num_system_allocs(0);
+std::atomic<uint64_t> system_bytes(0);
+std::atomic<int64_t> bytes_in_use(0);
+std::atomic<int64_t> peak_bytes_in_use(0);
+
+size_t ClassSize(uint32_t size_class)
+{
+    return (size_t)1 << (size_class + MIN_CLASS_SHIFT);
+}
+
+uint32_t SizeClass(size_t bytes)
+{
+    uint32_t c = 0;
+    while (ClassSize(c) < bytes)
+        ++c;
+    return c;
+}
+
+void CountInUse(int64_t delta)
+{
+    int64_t now = bytes_in_use.fetch_add(delta, std::memory_order_relaxed) + delta;
+    int64_t peak = peak_bytes_in_use.load(std::memory_order_relaxed);
+    while (now > peak && !peak_bytes_in_use.compare_exchange_weak(peak, now, std::memory_order_relaxed))
+        ;
+}
+
+// Turns what is left of the current chunk into free blocks of the largest classes that fit
+void SpillChunk(ThreadCache& c)
+{
+    while (c.ChunkLeft >= ClassSize(0))
+    {
+        uint32_t rest = std::min<uint32_t>(SizeClass(c.ChunkLeft), NUM_SIZE_CLASSES - 1);
+        if (ClassSize(rest) > c.ChunkLeft)
+            --rest;
+        FreeBlock* b = reinterpret_cast<FreeBlock*>(c.Chunk);
+        b->Next = c.Free[rest];
+        c.Free[rest] = b;
+        c.Chunk += ClassSize(rest);
+        c.ChunkLeft -= ClassSize(rest);
+    }
+    c.Chunk = 0;
+    c.ChunkLeft = 0;
+}
+
+// Moves the blocks an exited thread left in size class c to this thread's free list
+bool TakeOrphans(uint32_t c)
+{
+    if (!(orphan_classes.load(std::memory_order_relaxed) & (1u << c)))
+        return false;
+
+    std::lock_guard<std::mutex> lock(orphan_mutex);
+    cache.Free[c] = orphans[c];
+    orphans[c] = 0;
+    orphan_classes.fetch_and(~(1u << c), std::memory_order_relaxed);
+    return cache.Free[c] != 0;
+}
+
+unsigned char* MapChunk()
+{
+    void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (config.HugePages)
+        p = mmap(0, config.ChunkBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (p == MAP_FAILED)
+    {
+        // No reserved huge pages, transparent huge pages are the next best thing
+        p = mmap(0, config.ChunkBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            return 0;
+#ifdef MADV_HUGEPAGE
+        if (config.HugePages)
+            madvise(p, config.ChunkBytes, MADV_HUGEPAGE);
+#endif
+    }
+
+    num_system_allocs.fetch_add(1, std::memory_order_relaxed);
+    system_bytes.fetch_add(config.ChunkBytes, std::memory_order_relaxed);
+    return static_cast<unsigned char*>(p);
+}
+
+unsigned char* TakeChunk()
+{
+    {
+        std::lock_guard<std::mutex> lock(reserve_mutex);
+        if (!reserve.empty())
+        {
+            unsigned char* chunk = reserve.back();
+            reserve.pop_back();
+            return chunk;
+        }
+    }
+    return MapChunk();
+}
+
+void* AllocBlock(size_t size)
+{
+    size_t total = size + sizeof(BlockHeader);
+    BlockHeader* header;
+
+    if (total > MAX_POOLED_ALLOCATION)
+    {
+        header = static_cast<BlockHeader*>(std::malloc(total));
+        if (!header)
+            return 0;
+        header->SizeClass = LARGE_BLOCK;
+        num_system_allocs.fetch_add(1, std::memory_order_relaxed);
+        system_bytes.fetch_add(total, std::memory_order_relaxed);
+    }
+    else
+    {
+        uint32_t c = SizeClass(total);
+        if (cache.Free[c] || TakeOrphans(c))
+        {
+            FreeBlock* block = cache.Free[c];
+            cache.Free[c] = block->Next;
+            header = reinterpret_cast<BlockHeader*>(block);
+        }
+        else
+        {
+            size_t block_size = ClassSize(c);
+            if (cache.ChunkLeft < block_size)
+            {
+                // The rest of the old chunk is too small for this class, hand it out as smaller blocks later
+                SpillChunk(cache);
+
+                cache.Chunk = TakeChunk();
+                if (!cache.Chunk)
+                {
+                    cache.ChunkLeft = 0;
+                    return 0;
+                }
+                cache.ChunkLeft = config.ChunkBytes;
+            }
+
+            header = reinterpret_cast<BlockHeader*>(cache.Chunk);
+            cache.Chunk += block_size;
+            cache.ChunkLeft -= block_size;
+        }
+        header->SizeClass = c;
+    }
+
+    header->Size = size;
+    num_allocs.fetch_add(1, std::memory_order_relaxed);
+    CountInUse(size);
+    return header + 1;
+}
+
+void FreeBlockMemory(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+    num_frees.fetch_add(1, std::memory_order_relaxed);
+    CountInUse(-(int64_t)header->Size);
+
+    if (header->SizeClass == LARGE_BLOCK)
+    {
+        std::free(header);
+        return;
+    }
+
+    uint32_t c = header->SizeClass;
+    FreeBlock* block = reinterpret_cast<FreeBlock*>(header);
+    block->Next = cache.Free[c];
+    cache.Free[c] = block;
+}
+
+ThreadCache::~ThreadCache()
+{
+    SpillChunk(*this);
+
+    std::lock_guard<std::mutex> lock(orphan_mutex);
+    for(uint32_t c = 0; c < NUM_SIZE_CLASSES; ++c)
+    {
+        if (!Free[c])
+            continue;
+
+        // Append the orphans to the end of this list, that is one walk over the blocks of a thread that is exiting
+        FreeBlock* last = Free[c];
+        while (last->Next)
+            last = last->Next;
+        last->Next = orphans[c];
+        orphans[c] = Free[c];
+        Free[c] = 0;
+        orphan_classes.fetch_or(1u << c, std::memory_order_relaxed);
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void* ODEAlloc(size_t size)
+{
+    return AllocBlock(size);
+}
+
+void* ODERealloc(void* ptr, size_t /*old_size*/, size_t new_size)
+{
+    num_reallocs.fetch_add(1, std::memory_order_relaxed);
+
+    if (!ptr)
+        return ODEAlloc(new_size);
+
+    BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+    size_t old_size = header->Size;
+
+    // Still fits into the same block
+    if (header->SizeClass != LARGE_BLOCK && new_size + sizeof(BlockHeader) <= ClassSize(header->SizeClass))
+    {
+        CountInUse((int64_t)new_size - (int64_t)old_size);
+        header->Size = new_size;
+        return ptr;
+    }
+
+    void* p = AllocBlock(new_size);
+    if (!p)
+        return 0;
+    std::memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+    FreeBlockMemory(ptr);
+    return p;
+}
+
+void ODEFree(void* ptr, size_t /*size*/)
+{
+    FreeBlockMemory(ptr);
+}
+
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void InstallODEAllocator(const AllocConfig& c)
+{
+    if (installed.exchange(true))
+        return;
+
+    config = c;
+    config.ChunkBytes = config.ChunkBytes < 2 * MAX_POOLED_ALLOCATION ? 2 * MAX_POOLED_ALLOCATION : config.ChunkBytes;
+
+    if (config.ReserveBytes > 0)
+    {
+        std::lock_guard<std::mutex> lock(reserve_mutex);
+        for(size_t bytes = 0; bytes < config.ReserveBytes; bytes += config.ChunkBytes)
+        {
+            unsigned char* chunk = MapChunk();
+            if (!chunk)
+                break;
+
+            // Touch the pages now rather than in the middle of a step
+            std::memset(chunk, 0, config.ChunkBytes);
+            reserve.push_back(chunk);
+        }
+    }
+
+    dSetAllocHandler(&ODEAlloc);
+    dSetReallocHandler(&ODERealloc);
+    dSetFreeHandler(&ODEFree);
+}
+
+bool ODEAllocatorInstalled()
+{
+    return installed;
+}
+
+AllocStats GetODEAllocStats()
+{
+    AllocStats stats;
+    stats.Allocs = num_allocs.load(std::memory_order_relaxed);
+    stats.Frees = num_frees.load(std::memory_order_relaxed);
+    stats.Reallocs = num_reallocs.load(std::memory_order_relaxed);
+    stats.SystemAllocs = num_system_allocs.load(std::memory_order_relaxed);
+    stats.SystemBytes = system_bytes.load(std::memory_order_relaxed);
+    stats.BytesInUse = bytes_in_use.load(std::memory_order_relaxed);
+    stats.PeakBytesInUse = peak_bytes_in_use.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void ResetODEAllocPeak()
+{
+    peak_bytes_in_use.store(bytes_in_use.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
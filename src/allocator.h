@@ -0,0 +1,52 @@
+#ifndef ODE_EXAMPLE_ALLOCATOR_H
+#define ODE_EXAMPLE_ALLOCATOR_H
+
+#include <cstddef>
+#include <stdint.h>
+
+// Allocator for ODE's own memory (dSetAllocHandler / dSetReallocHandler / dSetFreeHandler). Every contact joint
+// created in the near callback and freed again by dJointGroupEmpty, and every temporary buffer of the collision
+// code, goes through these handlers, so with the system allocator a step makes many malloc / free calls.
+//
+// Requests up to MAX_POOLED_ALLOCATION bytes are rounded up to a size class and served from per-thread free lists.
+// Blocks that are freed go back to the free list of the thread that frees them. Free lists are refilled by carving
+// fresh blocks from large chunks, which are the only memory that is ever taken from the system. Chunks are never
+// given back, so once a simulation has reached its high water mark a step does not allocate from the system at all.
+// When a thread exits, its free blocks and the rest of its chunk are left for the next thread that runs out of a
+// size class, so short lived worker threads do not take a new chunk each.
+// Larger requests go straight to malloc and are counted as system allocations.
+struct AllocConfig
+{
+    size_t ChunkBytes;    // size of the chunks blocks are carved from
+    bool HugePages;       // back the chunks with huge pages if the system has them (otherwise the request is ignored)
+    size_t ReserveBytes;  // chunk memory to allocate up front
+
+    AllocConfig() : ChunkBytes(2 << 20), HugePages(false), ReserveBytes(0) {}
+};
+
+const size_t MAX_POOLED_ALLOCATION = 64 << 10;
+
+// All counters are totals since InstallODEAllocator, except BytesInUse which is the current value
+struct AllocStats
+{
+    uint64_t Allocs;         // alloc calls, and reallocs that needed a new block
+    uint64_t Frees;
+    uint64_t Reallocs;
+    uint64_t SystemAllocs;   // chunks and large blocks taken from the system
+    uint64_t SystemBytes;
+    int64_t BytesInUse;      // requested bytes currently allocated
+    int64_t PeakBytesInUse;  // since InstallODEAllocator or the last ResetODEAllocPeak
+};
+
+// Installs the handlers. This is process wide and must happen before dInitODE2: memory that ODE got from one
+// allocator cannot be freed by another, so the handlers can also never be removed again.
+void InstallODEAllocator(const AllocConfig& config = AllocConfig());
+
+bool ODEAllocatorInstalled();
+
+AllocStats GetODEAllocStats();
+
+// Starts a new peak measurement at the current BytesInUse, for example at the start of a step
+void ResetODEAllocPeak();
+
+#endif
@@ -0,0 +1,410 @@
+#include "ballistic.h"
+#include "simulation.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+// A body is ballistic for at least this many steps, otherwise it is not worth switching it over
+const uint64_t MIN_BALLISTIC_STEPS = 2;
+
+// Time covered by the neighbour query, in steps. No flight is longer, a body that is still clear gets a new bound
+// when it runs out.
+const uint64_t LOOKAHEAD_STEPS = 256;
+
+// A body whose bound came out too short is not asked again for this many steps
+const uint64_t RECHECK_STEPS = 8;
+
+dReal Dot(const dReal* a, const dReal* b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+dReal Length(const dReal* a)
+{
+    return std::sqrt(Dot(a, a));
+}
+
+// Smallest t >= 0 with a t^2 + b t + c <= 0, or dInfinity if there is none
+dReal FirstNonPositive(dReal a, dReal b, dReal c)
+{
+    if (c <= 0)
+        return 0;
+
+    if (a == 0)
+        return b < 0 ? -c / b : dInfinity;
+
+    dReal disc = b * b - 4 * a * c;
+    if (disc < 0)
+        return dInfinity;  // never reaches zero
+
+    dReal sq = std::sqrt(disc);
+    dReal t1 = (-b - sq) / (2 * a);
+    dReal t2 = (-b + sq) / (2 * a);
+    if (t1 > t2)
+        std::swap(t1, t2);
+
+    if (t1 >= 0)
+        return t1;
+    if (t2 >= 0)
+        return t2;
+    return dInfinity;
+}
+
+// Time until a gap of 'gap' is closed if it shrinks by at most speed * t + accel / 2 * t^2
+dReal TimeToClose(dReal gap, dReal speed, dReal accel)
+{
+    return FirstNonPositive(-accel / 2, -speed, gap);
+}
+
+// World space AABB of all geoms of a body
+void BodyAABB(dBodyID body, dReal aabb[6])
+{
+    aabb[0] = aabb[2] = aabb[4] = dInfinity;
+    aabb[1] = aabb[3] = aabb[5] = -dInfinity;
+
+    for(dGeomID g = dBodyGetFirstGeom(body); g; g = dBodyGetNextGeom(g))
+    {
+        dReal b[6];
+        dGeomGetAABB(g, b);
+        for(int k = 0; k < 3; ++k)
+        {
+            aabb[2 * k] = std::min(aabb[2 * k], b[2 * k]);
+            aabb[2 * k + 1] = std::max(aabb[2 * k + 1], b[2 * k + 1]);
+        }
+    }
+}
+
+// Radius of a sphere around the body position that contains all of its geoms in any orientation
+dReal BoundingRadius(dBodyID body)
+{
+    const dReal* p = dBodyGetPosition(body);
+    dReal aabb[6];
+    BodyAABB(body, aabb);
+
+    dReal r2 = 0;
+    for(int k = 0; k < 3; ++k)
+    {
+        dReal d = std::max(std::fabs(aabb[2 * k] - p[k]), std::fabs(aabb[2 * k + 1] - p[k]));
+        r2 += d * d;
+    }
+    return std::sqrt(r2);
+}
+
+dReal DistanceToAABB(const dReal* p, const dReal aabb[6])
+{
+    dReal d2 = 0;
+    for(int k = 0; k < 3; ++k)
+    {
+        dReal d = std::max((dReal)0, std::max(aabb[2 * k] - p[k], p[k] - aabb[2 * k + 1]));
+        d2 += d * d;
+    }
+    return std::sqrt(d2);
+}
+
+// A constant angular velocity is only the free rotation of a body whose inertia is the same about every axis,
+// anything else precesses
+bool IsIsotropic(dBodyID body)
+{
+    dMass m;
+    dBodyGetMass(body, &m);
+    const dReal* I = m.I;
+    dReal tolerance = 1e-9 * std::fabs(I[0]);
+    return std::fabs(I[1]) <= tolerance && std::fabs(I[2]) <= tolerance && std::fabs(I[4]) <= tolerance &&
+           std::fabs(I[6]) <= tolerance && std::fabs(I[8]) <= tolerance && std::fabs(I[9]) <= tolerance &&
+           std::fabs(I[5] - I[0]) <= tolerance && std::fabs(I[10] - I[0]) <= tolerance;
+}
+
+bool IsCandidate(dBodyID body)
+{
+    if (!dBodyIsEnabled(body) || !dBodyGetGravityMode(body) || dBodyGetNumJoints(body) != 0)
+        return false;
+    if (dBodyGetLinearDamping(body) != 0 || dBodyGetAngularDamping(body) != 0 || !IsIsotropic(body))
+        return false;
+
+    const dReal* f = dBodyGetForce(body);
+    const dReal* t = dBodyGetTorque(body);
+    return Dot(f, f) == 0 && Dot(t, t) == 0;
+}
+
+void CollectNeighbour(void* data, dGeomID o1, dGeomID o2)
+{
+    if (dGeomIsSpace(o1) || dGeomIsSpace(o2))
+    {
+        dSpaceCollide2(o1, o2, data, &CollectNeighbour);
+        return;
+    }
+
+    BallisticState* state = static_cast<BallisticState*>(data);
+    state->Neighbours.push_back(o1 == state->Query ? o2 : o1);
+}
+
+// Conservative time for which 'body' can be moved analytically. Nothing outside a sphere of radius 'reach' can get
+// to the body within 'lookahead', so only the geoms whose AABBs overlap that sphere's AABB are looked at.
+dReal BallisticHorizon(Simulation& sim, size_t index, dReal max_speed, dReal max_radius, dReal margin,
+                       dReal lookahead)
+{
+    BallisticState& state = sim.Ballistic;
+    dBodyID body = sim.Objects[index].Body;
+    const dReal* p = dBodyGetPosition(body);
+    const dReal* v = dBodyGetLinearVel(body);
+    dReal r = state.Bodies[index].Radius;
+
+    dVector3 g;
+    dWorldGetGravity(sim.World, g);
+    dReal g_len = Length(g);
+    dReal speed = Length(v);
+
+    // Closing speed and acceleration against the fastest thing the bound allows
+    dReal reach = r + max_radius + margin + (speed + 2 * max_speed) * lookahead + g_len * lookahead * lookahead;
+
+    if (!state.Query)
+        state.Query = dCreateSphere(0, reach);
+    else
+        dGeomSphereSetRadius(state.Query, reach);
+    dGeomSetPosition(state.Query, p[0], p[1], p[2]);
+
+    state.Neighbours.clear();
+    dSpaceCollide2(state.Query, (dGeomID)sim.Space, &state, &CollectNeighbour);
+    dSpaceCollide2(state.Query, (dGeomID)sim.StaticSpace, &state, &CollectNeighbour);
+
+    dReal horizon = lookahead;
+    for(size_t i = 0; i < state.Neighbours.size() && horizon > 0; ++i)
+    {
+        dGeomID geom = state.Neighbours[i];
+        dBodyID other = dGeomGetBody(geom);
+        if (other == body)
+            continue;
+
+        if (!other)
+        {
+            // Static geometry does not move, only our own motion closes the gap. Planes are solved exactly along
+            // their normal, everything else through its AABB.
+            if (dGeomGetClass(geom) == dPlaneClass)
+            {
+                dVector4 plane;
+                dGeomPlaneGetParams(geom, plane);
+                dReal gap = Dot(plane, p) - plane[3] - r - margin;
+                horizon = std::min(horizon, FirstNonPositive(Dot(plane, g) / 2, Dot(plane, v), gap));
+            }
+            else
+            {
+                dReal aabb[6];
+                dGeomGetAABB(geom, aabb);
+                horizon = std::min(horizon, TimeToClose(DistanceToAABB(p, aabb) - r - margin, speed, g_len));
+            }
+            continue;
+        }
+
+        // Other bodies move too. A ballistic one along its parabola, anything else could be pushed by a collision,
+        // so it is allowed up to twice the largest speed in the world. BeginBallisticStep holds it to that.
+        size_t j = (size_t)dBodyGetData(other);
+        bool known = j < state.Bodies.size() && sim.Objects[j].Body == other;
+        dReal other_speed = known && state.Bodies[j].Active ? Length(dBodyGetLinearVel(other)) : 2 * max_speed;
+        dReal other_radius = known ? state.Bodies[j].Radius : BoundingRadius(other);
+
+        const dReal* q = dBodyGetPosition(other);
+        dReal d[3] = { q[0] - p[0], q[1] - p[1], q[2] - p[2] };
+        dReal gap = Length(d) - r - other_radius - margin;
+
+        horizon = std::min(horizon, TimeToClose(gap, speed + other_speed, 2 * g_len));
+    }
+
+    return horizon;
+}
+
+}
+
+bool BeginBallisticStep(Simulation& sim, double dt)
+{
+    BallisticState& state = sim.Ballistic;
+    state.Bodies.resize(sim.Objects.size());
+    state.Candidate.resize(sim.Objects.size());
+
+    // Bodies whose bound ran out go back to normal simulation
+    for(size_t i = 0; i < state.Bodies.size(); ++i)
+    {
+        if (state.Bodies[i].Active && state.Bodies[i].EndStep <= sim.StepCount)
+            state.Bodies[i].Active = false;
+    }
+
+    // Input from outside could push anything anywhere
+    if (sim.InputPending)
+    {
+        CancelBallisticFlights(sim);
+        return false;
+    }
+
+    dReal max_speed = 0;
+    dReal free_speed = 0;  // largest speed of the bodies that are simulated normally
+    dReal max_radius = 0;
+    for(size_t i = 0; i < sim.Objects.size(); ++i)
+    {
+        dBodyID body = sim.Objects[i].Body;
+        BallisticBody& b = state.Bodies[i];
+
+        if (b.Radius < 0)
+            b.Radius = BoundingRadius(body);
+        max_radius = std::max(max_radius, b.Radius);
+
+        state.Candidate[i] = b.Active || IsCandidate(body);
+        if (dBodyIsEnabled(body))
+        {
+            dReal speed = Length(dBodyGetLinearVel(body));
+            max_speed = std::max(max_speed, speed);
+            if (!b.Active)
+                free_speed = std::max(free_speed, speed);
+        }
+    }
+
+    dVector3 g;
+    dWorldGetGravity(sim.World, g);
+    dReal g_len = Length(g);
+
+    // A bound only holds while the normally simulated bodies are no faster than it allowed, plus what gravity adds.
+    // Something that was hit harder than that ends every flight that did not account for it.
+    for(size_t i = 0; i < state.Bodies.size(); ++i)
+    {
+        BallisticBody& b = state.Bodies[i];
+        if (b.Active && free_speed > b.SpeedBound + g_len * (dReal)(sim.StepCount + 1 - b.StartStep) * dt)
+            b.Active = false;
+    }
+
+    // Keep a step's worth of motion plus the contact surface layer between the body and anything else
+    dReal margin = dWorldGetContactSurfaceLayer(sim.World) + g_len * dt * dt + 2 * max_speed * dt;
+    dReal lookahead = (dReal)(LOOKAHEAD_STEPS * dt);
+
+    for(size_t i = 0; i < sim.Objects.size(); ++i)
+    {
+        BallisticBody& b = state.Bodies[i];
+        if (b.Active || !state.Candidate[i] || b.NextCheck > sim.StepCount)
+            continue;
+
+        dReal horizon = BallisticHorizon(sim, i, max_speed, max_radius, margin, lookahead);
+        uint64_t steps = horizon >= lookahead ? LOOKAHEAD_STEPS : (uint64_t)(horizon / dt);
+        if (steps < MIN_BALLISTIC_STEPS)
+        {
+            b.NextCheck = sim.StepCount + RECHECK_STEPS;
+            continue;
+        }
+
+        b.Active = true;
+        b.StartStep = sim.StepCount;
+        b.EndStep = sim.StepCount + steps;
+        b.SpeedBound = 2 * max_speed;
+
+        dBodyID body = sim.Objects[i].Body;
+        const dReal* p = dBodyGetPosition(body);
+        const dReal* v = dBodyGetLinearVel(body);
+        const dReal* w = dBodyGetAngularVel(body);
+        const dReal* q = dBodyGetQuaternion(body);
+        for(int k = 0; k < 3; ++k)
+        {
+            b.P0[k] = p[k];
+            b.V0[k] = v[k];
+            b.W0[k] = w[k];
+        }
+        for(int k = 0; k < 4; ++k)
+            b.Q0[k] = q[k];
+    }
+
+    // Only now the geoms go, the queries above have to see the ones of bodies that went ballistic before them
+    size_t awake = 0;
+    size_t ballistic = 0;
+    for(size_t i = 0; i < sim.Objects.size(); ++i)
+    {
+        dBodyID body = sim.Objects[i].Body;
+        if (state.Bodies[i].Active)
+        {
+            ++ballistic;
+            for(dGeomID geom = dBodyGetFirstGeom(body); geom; geom = dBodyGetNextGeom(geom))
+                dGeomDisable(geom);
+        }
+        else if (dBodyIsEnabled(body))
+            ++awake;
+    }
+
+    state.BallisticBodySteps += ballistic;
+
+    if (ballistic == 0)
+        return false;
+
+    if (awake == 0)
+    {
+        ++state.SkippedSteps;
+        return true;
+    }
+
+    // Other bodies still need the solver, take the ballistic ones out of it for this step
+    for(size_t i = 0; i < state.Bodies.size(); ++i)
+    {
+        BallisticBody& b = state.Bodies[i];
+        b.BodyDisabled = b.Active;
+        if (b.Active)
+            dBodyDisable(sim.Objects[i].Body);
+    }
+    return false;
+}
+
+void EndBallisticStep(Simulation& sim, double dt)
+{
+    BallisticState& state = sim.Ballistic;
+
+    dVector3 g;
+    dWorldGetGravity(sim.World, g);
+
+    for(size_t i = 0; i < state.Bodies.size(); ++i)
+    {
+        BallisticBody& b = state.Bodies[i];
+        if (!b.Active)
+            continue;
+
+        dBodyID body = sim.Objects[i].Body;
+        if (b.BodyDisabled)
+        {
+            dBodyEnable(body);
+            b.BodyDisabled = false;
+        }
+
+        for(dGeomID geom = dBodyGetFirstGeom(body); geom; geom = dBodyGetNextGeom(geom))
+            dGeomEnable(geom);
+
+        // Always evaluated from the state at the start of the flight, so no error accumulates over the steps
+        dReal t = (dReal)(sim.StepCount + 1 - b.StartStep) * dt;
+
+        dBodySetPosition(body, b.P0[0] + b.V0[0] * t + g[0] * t * t / 2,
+                               b.P0[1] + b.V0[1] * t + g[1] * t * t / 2,
+                               b.P0[2] + b.V0[2] * t + g[2] * t * t / 2);
+        dBodySetLinearVel(body, b.V0[0] + g[0] * t, b.V0[1] + g[1] * t, b.V0[2] + g[2] * t);
+
+        // Rotation by angle |w| t around w, applied on top of the initial orientation
+        dReal w_len = Length(b.W0);
+        if (w_len > 0)
+        {
+            dQuaternion dq, q;
+            dQFromAxisAndAngle(dq, b.W0[0], b.W0[1], b.W0[2], w_len * t);
+            dQMultiply0(q, dq, b.Q0);
+            dBodySetQuaternion(body, q);
+        }
+        dBodySetAngularVel(body, b.W0[0], b.W0[1], b.W0[2]);
+    }
+}
+
+void CancelBallisticFlights(Simulation& sim)
+{
+    std::vector<BallisticBody>& bodies = sim.Ballistic.Bodies;
+    for(size_t i = 0; i < bodies.size(); ++i)
+    {
+        bodies[i].Active = false;
+        bodies[i].NextCheck = 0;
+    }
+}
+
+void ReleaseBallistic(Simulation& sim)
+{
+    if (sim.Ballistic.Query)
+        dGeomDestroy(sim.Ballistic.Query);
+    sim.Ballistic = BallisticState();
+}
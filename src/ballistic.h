@@ -0,0 +1,72 @@
+#ifndef ODE_EXAMPLE_BALLISTIC_H
+#define ODE_EXAMPLE_BALLISTIC_H
+
+#define dDOUBLE
+#include <ode/ode.h>
+
+#include <stdint.h>
+#include <vector>
+
+struct Simulation;
+
+// Ballistic fast-forward. A body that has no joints, is only pulled by gravity and is far away from every other geom
+// follows a parabola that can be written down in closed form. For such bodies a time-of-impact bound is computed
+// once: the earliest moment at which the body's bounding sphere could get within reach of anything else. Until then
+// the body is moved analytically and its geoms and body are taken out of collision detection and the solver. If all
+// awake bodies are ballistic the whole dSpaceCollide / dWorldQuickStep is skipped.
+//
+// The bound is exact against planes. Against other geoms it assumes that no body that is simulated normally gets
+// faster than twice the largest speed in the world at the time the bound was computed, plus what gravity adds since.
+// That is checked every step, a flight whose assumption no longer holds is ended. Forces added to a body in flight
+// are not seen, set Simulation::InputPending before applying them. Rotation keeps the angular velocity constant,
+// which is only exact for an isotropic inertia, so only undamped bodies whose inertia is the same about every axis
+// (cubes, spheres) are ever put in flight.
+//
+// Only the geoms near a body are looked at, through a query sphere that is collided against the world's spaces. The
+// sphere covers a fixed look-ahead time, anything outside of it cannot be reached sooner. A bound is kept until it
+// runs out, and a body that did not get a long enough bound is not asked again for a few steps, so the query does
+// not run for every body in every step.
+struct BallisticBody
+{
+    bool Active;
+    uint64_t StartStep;  // sim.StepCount when the body went ballistic
+    uint64_t EndStep;    // first step at which the body has to be simulated normally again
+    bool BodyDisabled;   // the body was disabled for the current step, EndBallisticStep enables it again
+    uint64_t NextCheck;  // first step at which the bound is computed again after an attempt that was too short
+    dReal SpeedBound;    // speed the other bodies were allowed when the bound was computed
+    dReal Radius;        // bounding sphere radius, negative until it is known
+    dVector3 P0, V0, W0;
+    dQuaternion Q0;
+
+    BallisticBody() : Active(false), StartStep(0), EndStep(0), BodyDisabled(false), NextCheck(0), SpeedBound(0),
+                      Radius(-1) {}
+};
+
+struct BallisticState
+{
+    std::vector<BallisticBody> Bodies;  // indexed like sim.Objects
+    uint64_t SkippedSteps;              // steps in which the solver did not run at all
+    uint64_t BallisticBodySteps;        // sum over steps of the number of bodies moved analytically
+
+    // Kept between steps so BeginBallisticStep does not allocate
+    std::vector<char> Candidate;
+    std::vector<dGeomID> Neighbours;
+    dGeomID Query;                      // sphere in no space, created on first use
+
+    BallisticState() : SkippedSteps(0), BallisticBodySteps(0), Query(0) {}
+};
+
+// Called by SimLoop around the collision and solver phases when Simulation::BallisticFastForward is set. Begin picks
+// the ballistic bodies and takes them out of the step, it returns true if no awake body is left and the solver can be
+// skipped. End moves the ballistic bodies to where they are after this step and puts them back.
+bool BeginBallisticStep(Simulation& sim, double dt);
+void EndBallisticStep(Simulation& sim, double dt);
+
+// Ends every flight in progress, for when the bodies were moved from outside (rewind, snapshots, state import) and
+// the bounds no longer hold. The next step computes them again.
+void CancelBallisticFlights(Simulation& sim);
+
+// Destroys the query geom and clears the state. CloseODE calls this.
+void ReleaseBallistic(Simulation& sim);
+
+#endif
@@ -0,0 +1,43 @@
+#include "batch.h"
+
+BatchSimulation::BatchSimulation(size_t num_worlds, unsigned num_threads, uint64_t run_id)
+    : worlds_(num_worlds), pool_(num_threads)
+{
+    // Every world draws from its own random stream, so they can be built in parallel
+    pool_.ParallelFor(worlds_.size(), [this, run_id](size_t i, unsigned)
+    {
+        worlds_[i].Random = RandomStream(run_id, i);
+        InitODE(worlds_[i]);
+    });
+}
+
+BatchSimulation::BatchSimulation(const WorldTemplate& source, size_t num_worlds, unsigned num_threads)
+    : worlds_(num_worlds), pool_(num_threads)
+{
+    CloneWorlds(source, worlds_, pool_);
+}
+
+BatchSimulation::~BatchSimulation()
+{
+    for(size_t i = 0; i < worlds_.size(); ++i)
+        CloseODE(worlds_[i]);
+}
+
+void BatchSimulation::Step(double dt)
+{
+    pool_.ParallelFor(worlds_.size(), [this, dt](size_t i, unsigned)
+    {
+        // Worlds that have come to rest are only counted, not stepped (see RunSteps)
+        RunSteps(worlds_[i], dt, 1);
+    });
+}
+
+bool BatchSimulation::AllAtRest() const
+{
+    for(size_t i = 0; i < worlds_.size(); ++i)
+    {
+        if (!AtRest(worlds_[i]))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef ODE_EXAMPLE_BATCH_H
+#define ODE_EXAMPLE_BATCH_H
+
+#include "simulation.h"
+#include "thread_pool.h"
+#include "world_template.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+// Holds a number of independent Simulation instances and steps all of them in parallel on a ThreadPool. A call to
+// Step advances every world by one SimLoop and returns once all of them are done, so there is exactly one barrier
+// per step. Worlds never share ODE objects, the only thing they have in common is the pool that steps them.
+class BatchSimulation
+{
+public:
+    // num_threads == 0 uses one thread per hardware core. World i is built by InitODE with RandomStream(run_id, i),
+    // so the batch is the same for the same run_id whatever the number of threads.
+    BatchSimulation(size_t num_worlds, unsigned num_threads = 0, uint64_t run_id = 0);
+
+    // All worlds are clones of one template (see WorldTemplate), built in parallel on the pool
+    BatchSimulation(const WorldTemplate& source, size_t num_worlds, unsigned num_threads = 0);
+    ~BatchSimulation();
+
+    // Worlds that are at rest (see AtRest) are not stepped, only their StepCount advances
+    void Step(double dt);
+
+    // True once every world is at rest, further steps would not change anything
+    bool AllAtRest() const;
+
+    size_t NumWorlds() const { return worlds_.size(); }
+    Simulation& World(size_t i) { return worlds_[i]; }
+    const Simulation& World(size_t i) const { return worlds_[i]; }
+
+    ThreadPool& Pool() { return pool_; }
+
+private:
+    BatchSimulation(const BatchSimulation&);
+    BatchSimulation& operator=(const BatchSimulation&);
+
+    std::vector<Simulation> worlds_;
+    ThreadPool pool_;
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include "body_state.h"
+
+#include <cstdlib>
+#include <new>
+
+BodyStateArrays::BodyStateArrays() : Enabled(0)
+{
+    for(int k = 0; k < 3; ++k)
+    {
+        Position[k] = 0;
+        LinearVel[k] = 0;
+        AngularVel[k] = 0;
+    }
+    for(int k = 0; k < 4; ++k)
+        Quaternion[k] = 0;
+}
+
+void ExportBodyStates(const Simulation& sim, const BodyStateArrays& out, size_t count, const uint32_t* indices)
+{
+    for(size_t j = 0; j < count; ++j)
+    {
+        dBodyID body = sim.Objects[indices ? indices[j] : j].Body;
+
+        // Each of these is a pointer into the body, no copy is made until the components are stored
+        if (out.Position[0])
+        {
+            const dReal* p = dBodyGetPosition(body);
+            out.Position[0][j] = p[0];
+            out.Position[1][j] = p[1];
+            out.Position[2][j] = p[2];
+        }
+        if (out.Quaternion[0])
+        {
+            const dReal* q = dBodyGetQuaternion(body);
+            out.Quaternion[0][j] = q[0];
+            out.Quaternion[1][j] = q[1];
+            out.Quaternion[2][j] = q[2];
+            out.Quaternion[3][j] = q[3];
+        }
+        if (out.LinearVel[0])
+        {
+            const dReal* v = dBodyGetLinearVel(body);
+            out.LinearVel[0][j] = v[0];
+            out.LinearVel[1][j] = v[1];
+            out.LinearVel[2][j] = v[2];
+        }
+        if (out.AngularVel[0])
+        {
+            const dReal* w = dBodyGetAngularVel(body);
+            out.AngularVel[0][j] = w[0];
+            out.AngularVel[1][j] = w[1];
+            out.AngularVel[2][j] = w[2];
+        }
+        if (out.Enabled)
+            out.Enabled[j] = dBodyIsEnabled(body) ? 1 : 0;
+    }
+}
+
+void ImportBodyStates(Simulation& sim, const BodyStateArrays& in, size_t count, const uint32_t* indices,
+                      const uint8_t* mask)
+{
+    for(size_t j = 0; j < count; ++j)
+    {
+        if (mask && !mask[j])
+            continue;
+
+        size_t i = indices ? indices[j] : j;
+        dBodyID body = sim.Objects[i].Body;
+
+        if (in.Position[0])
+            dBodySetPosition(body, in.Position[0][j], in.Position[1][j], in.Position[2][j]);
+        if (in.Quaternion[0])
+        {
+            dQuaternion q = { in.Quaternion[0][j], in.Quaternion[1][j], in.Quaternion[2][j], in.Quaternion[3][j] };
+            dBodySetQuaternion(body, q);
+        }
+        if (in.LinearVel[0])
+            dBodySetLinearVel(body, in.LinearVel[0][j], in.LinearVel[1][j], in.LinearVel[2][j]);
+        if (in.AngularVel[0])
+            dBodySetAngularVel(body, in.AngularVel[0][j], in.AngularVel[1][j], in.AngularVel[2][j]);
+
+        // Enabling also restarts the body's auto disable countdown
+        if (!in.Enabled || in.Enabled[j])
+            dBodyEnable(body);
+        else
+            dBodyDisable(body);
+    }
+
+    // The flights of the other bodies were bounded against the old poses too
+    CancelBallisticFlights(sim);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+namespace
+{
+
+const size_t PLANE_ALIGNMENT = 64;
+const size_t PLANE_PADDING = 8;     // entries
+const int NUM_REAL_PLANES = 13;     // 3 position, 4 quaternion, 3 linear and 3 angular velocity
+
+}
+
+BodyStateBuffer::BodyStateBuffer(size_t capacity) : data_(0), capacity_(0), stride_(0)
+{
+    Reserve(capacity);
+}
+
+BodyStateBuffer::~BodyStateBuffer()
+{
+    std::free(data_);
+}
+
+void BodyStateBuffer::Reserve(size_t capacity)
+{
+    if (capacity <= capacity_ && data_)
+        return;
+
+    std::free(data_);
+    data_ = 0;
+    arrays_ = BodyStateArrays();
+
+    // 8 doubles are 64 bytes, so with the padding every dReal plane starts aligned. The enabled flags come last.
+    stride_ = (capacity + PLANE_PADDING - 1) / PLANE_PADDING * PLANE_PADDING;
+    if (stride_ == 0)
+        stride_ = PLANE_PADDING;
+    size_t bytes = NUM_REAL_PLANES * stride_ * sizeof(dReal) + stride_;
+
+    if (posix_memalign(&data_, PLANE_ALIGNMENT, bytes) != 0)
+        throw std::bad_alloc();
+    capacity_ = capacity;
+
+    dReal* planes = static_cast<dReal*>(data_);
+    for(int k = 0; k < 3; ++k)
+    {
+        arrays_.Position[k] = planes + k * stride_;
+        arrays_.LinearVel[k] = planes + (7 + k) * stride_;
+        arrays_.AngularVel[k] = planes + (10 + k) * stride_;
+    }
+    for(int k = 0; k < 4; ++k)
+        arrays_.Quaternion[k] = planes + (3 + k) * stride_;
+    arrays_.Enabled = reinterpret_cast<uint8_t*>(planes + NUM_REAL_PLANES * stride_);
+}
@@ -0,0 +1,73 @@
+#ifndef ODE_EXAMPLE_BODY_STATE_H
+#define ODE_EXAMPLE_BODY_STATE_H
+
+#include "simulation.h"
+
+#include <cstddef>
+#include <stdint.h>
+
+// Bulk access to the state of many bodies at once, for controllers and loggers that work on all bodies together
+// instead of calling dBodyGetPosition & co. for each of them.
+//
+// The layout is a structure of arrays with one plane per component: Position[0] holds the x coordinates of all
+// exported bodies, Position[1] the y coordinates and so on, so a consumer can load 4 or 8 bodies' x coordinates into
+// one SIMD register. Any pointer may be null, that quantity is then skipped.
+struct BodyStateArrays
+{
+    dReal* Position[3];
+    dReal* Quaternion[4];  // w x y z
+    dReal* LinearVel[3];
+    dReal* AngularVel[3];
+    uint8_t* Enabled;
+
+    BodyStateArrays();
+};
+
+// Copies the state of count bodies into entries 0 .. count - 1 of the arrays. Entry j is body indices[j] of
+// sim.Objects, or body j if indices is null. One pass over the bodies, nothing is allocated.
+void ExportBodyStates(const Simulation& sim, const BodyStateArrays& out, size_t count, const uint32_t* indices = 0);
+
+// Convenience for all bodies
+inline void ExportBodyStates(const Simulation& sim, const BodyStateArrays& out)
+{
+    ExportBodyStates(sim, out, sim.Objects.size());
+}
+
+// The reverse of ExportBodyStates: entry j of the arrays is written into body indices[j] (or body j). If mask is
+// given, entries with mask[j] == 0 are skipped. Null planes leave that quantity of the bodies unchanged. If the
+// Enabled plane is given the bodies are enabled or disabled accordingly, otherwise every written body is enabled so
+// it takes part in the next step even if it was asleep. Setting the pose through the body marks its geoms as moved,
+// so their AABBs are recomputed by the next collision pass. Flights in progress (see ballistic.h) are ended, their
+// bounds were computed against the old poses.
+void ImportBodyStates(Simulation& sim, const BodyStateArrays& in, size_t count, const uint32_t* indices = 0,
+                      const uint8_t* mask = 0);
+
+// Owns the planes of a BodyStateArrays for up to 'capacity' bodies. Every plane starts on a 64 byte boundary and
+// is padded to a multiple of 8 entries, so vector loops over the planes need no remainder handling for alignment.
+class BodyStateBuffer
+{
+public:
+    explicit BodyStateBuffer(size_t capacity = 0);
+    ~BodyStateBuffer();
+
+    // Reallocates only if the capacity grows, the contents are not kept
+    void Reserve(size_t capacity);
+
+    size_t Capacity() const { return capacity_; }
+
+    // Number of entries in a plane including the padding
+    size_t Stride() const { return stride_; }
+
+    const BodyStateArrays& Arrays() const { return arrays_; }
+
+private:
+    BodyStateBuffer(const BodyStateBuffer&);
+    BodyStateBuffer& operator=(const BodyStateBuffer&);
+
+    void* data_;
+    size_t capacity_;
+    size_t stride_;
+    BodyStateArrays arrays_;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#include "broadphase.h"
+
+#include <algorithm>
+#include <cmath>
+
+dSpaceID CreateSpace(const BroadphaseConfig& config, dSpaceID parent)
+{
+    switch (config.Type)
+    {
+    case BROADPHASE_HASH:
+    {
+        dSpaceID space = dHashSpaceCreate(parent);
+        dHashSpaceSetLevels(space, config.HashMinLevel, config.HashMaxLevel);
+        return space;
+    }
+    case BROADPHASE_SAP:
+        return dSweepAndPruneSpaceCreate(parent, config.SapAxisOrder);
+    case BROADPHASE_QUADTREE:
+    {
+        dVector3 center = { config.QuadTreeCenter[0], config.QuadTreeCenter[1], config.QuadTreeCenter[2], 0 };
+        dVector3 extents = { config.QuadTreeExtents[0], config.QuadTreeExtents[1], config.QuadTreeExtents[2], 0 };
+        return dQuadTreeSpaceCreate(parent, center, extents, config.QuadTreeDepth);
+    }
+    case BROADPHASE_SIMPLE:
+    default:
+        return dSimpleSpaceCreate(parent);
+    }
+}
+
+void TuneBroadphase(dSpaceID space, const BroadphaseConfig& config)
+{
+    if (config.Type != BROADPHASE_HASH || !config.HashAutoLevels)
+        return;
+
+    dReal smallest = dInfinity;
+    dReal largest = 0;
+
+    int n = dSpaceGetNumGeoms(space);
+    for(int i = 0; i < n; ++i)
+    {
+        dReal aabb[6];
+        dGeomGetAABB(dSpaceGetGeom(space, i), aabb);
+
+        // Use the largest side of the box, that is the cell size the geom has to fit in. Planes and other infinite
+        // geoms are kept in a separate list by the hash space and do not influence the grid.
+        dReal size = std::max(aabb[1] - aabb[0], std::max(aabb[3] - aabb[2], aabb[5] - aabb[4]));
+        if (!(size < dInfinity) || size <= 0)
+            continue;
+
+        smallest = std::min(smallest, size);
+        largest = std::max(largest, size);
+    }
+
+    if (largest == 0)
+        return;
+
+    int min_level = (int)std::floor(std::log2(smallest));
+    int max_level = std::max(min_level, (int)std::ceil(std::log2(largest)));
+    dHashSpaceSetLevels(space, min_level, max_level);
+}
+
+const char* BroadphaseName(BroadphaseType type)
+{
+    switch (type)
+    {
+    case BROADPHASE_SIMPLE: return "simple";
+    case BROADPHASE_HASH: return "hash";
+    case BROADPHASE_SAP: return "sap";
+    case BROADPHASE_QUADTREE: return "quadtree";
+    }
+    return "unknown";
+}
+
+bool ParseBroadphase(const std::string& name, BroadphaseType& type)
+{
+    static const BroadphaseType TYPES[] = { BROADPHASE_SIMPLE, BROADPHASE_HASH, BROADPHASE_SAP, BROADPHASE_QUADTREE };
+    for(size_t i = 0; i < sizeof(TYPES) / sizeof(TYPES[0]); ++i)
+    {
+        if (name == BroadphaseName(TYPES[i]))
+        {
+            type = TYPES[i];
+            return true;
+        }
+    }
+    return false;
+}
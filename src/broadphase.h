@@ -0,0 +1,65 @@
+#ifndef ODE_EXAMPLE_BROADPHASE_H
+#define ODE_EXAMPLE_BROADPHASE_H
+
+#define dDOUBLE
+#include <ode/ode.h>
+
+#include <string>
+
+// The collision space decides which geom pairs dSpaceCollide hands to the near callback. A simple space tests every
+// pair (O(n^2)), which is fine for a handful of geoms but not for large scenes:
+//
+//   simple    - every pair, no overhead, best for a few dozen geoms
+//   hash      - multi resolution hash grid, good general purpose choice when geom sizes are similar
+//   sap       - sweep and prune along the axes, good for many geoms spread out along one axis
+//   quadtree  - fixed quadtree over a known region, good for large flat scenes. ODE assumes Z is up and splits on X
+//               and Y only, so in a Y-up world it splits X and the height and does not help with bodies spread over
+//               the ground, use hash or sap there
+
+enum BroadphaseType
+{
+    BROADPHASE_SIMPLE,
+    BROADPHASE_HASH,
+    BROADPHASE_SAP,
+    BROADPHASE_QUADTREE
+};
+
+struct BroadphaseConfig
+{
+    BroadphaseType Type;
+
+    // hash: cell sizes range from 2^HashMinLevel to 2^HashMaxLevel. With HashAutoLevels the levels are derived from
+    // the geoms in the space by TuneBroadphase.
+    int HashMinLevel;
+    int HashMaxLevel;
+    bool HashAutoLevels;
+
+    // sap: one of the dSAP_AXES_* constants, the first axis should be the one along which the geoms are spread most
+    int SapAxisOrder;
+
+    // quadtree: region covered by the tree, as its center and half its size along each axis, and the number of
+    // subdivisions. Only X and Y are subdivided.
+    dReal QuadTreeCenter[3];
+    dReal QuadTreeExtents[3];
+    int QuadTreeDepth;
+
+    BroadphaseConfig() : Type(BROADPHASE_SIMPLE), HashMinLevel(-3), HashMaxLevel(10), HashAutoLevels(true),
+                         SapAxisOrder(dSAP_AXES_XZY), QuadTreeDepth(6)
+    {
+        QuadTreeCenter[0] = QuadTreeCenter[1] = QuadTreeCenter[2] = 0;
+        QuadTreeExtents[0] = QuadTreeExtents[1] = QuadTreeExtents[2] = 200;
+    }
+};
+
+dSpaceID CreateSpace(const BroadphaseConfig& config, dSpaceID parent = 0);
+
+// Call once the geoms have been added to a space created by CreateSpace. For a hash space with HashAutoLevels this
+// picks the levels so the smallest cell fits the smallest geom and the largest cell the largest finite geom. Does
+// nothing for other space types.
+void TuneBroadphase(dSpaceID space, const BroadphaseConfig& config);
+
+// "simple", "hash", "sap" or "quadtree"
+const char* BroadphaseName(BroadphaseType type);
+bool ParseBroadphase(const std::string& name, BroadphaseType& type);
+
+#endif
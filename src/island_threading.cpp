@@ -0,0 +1,52 @@
+#include "island_threading.h"
+#include "simulation.h"
+
+#include <iostream>
+
+bool EnableIslandThreading(Simulation& sim, unsigned num_threads)
+{
+    DisableIslandThreading(sim);
+
+    if (num_threads < 2)
+        return true;
+
+    sim.Threading = dThreadingAllocateMultiThreadedImplementation();
+    if (!sim.Threading)
+    {
+        std::cerr << "[EnableIslandThreading] ODE was built without threading support" << std::endl;
+        return false;
+    }
+
+    // The pool threads only run the solver, they never call collision functions, so they only need the basic
+    // thread data
+    sim.ThreadingPool = dThreadingAllocateThreadPool(num_threads, 0, dAllocateFlagBasicData, 0);
+    if (!sim.ThreadingPool)
+    {
+        std::cerr << "[EnableIslandThreading] Could not start " << num_threads << " threads" << std::endl;
+        dThreadingFreeImplementation(sim.Threading);
+        sim.Threading = 0;
+        return false;
+    }
+
+    dThreadingThreadPoolServeMultiThreadedImplementation(sim.ThreadingPool, sim.Threading);
+
+    dWorldSetStepIslandsProcessingMaxThreadCount(sim.World, num_threads);
+    dWorldSetStepThreadingImplementation(sim.World, dThreadingImplementationGetFunctions(sim.Threading), sim.Threading);
+    return true;
+}
+
+void DisableIslandThreading(Simulation& sim)
+{
+    if (!sim.Threading)
+        return;
+
+    // Same order as in the ODE demos: stop serving, free the pool, detach from the world and only then free the
+    // implementation itself
+    dThreadingImplementationShutdownProcessing(sim.Threading);
+    dThreadingFreeThreadPool(sim.ThreadingPool);
+    dWorldSetStepThreadingImplementation(sim.World, 0, 0);
+    dThreadingFreeImplementation(sim.Threading);
+
+    sim.Threading = 0;
+    sim.ThreadingPool = 0;
+}
@@ -0,0 +1,16 @@
+#ifndef ODE_EXAMPLE_ISLAND_THREADING_H
+#define ODE_EXAMPLE_ISLAND_THREADING_H
+
+struct Simulation;
+
+// ODE splits the bodies of a world into islands, groups of bodies connected by joints (contacts included). Islands do
+// not influence each other within a step, so ODE can solve them in parallel if the world has a threading
+// implementation attached. This creates ODE's built-in implementation with a pool of num_threads threads and attaches
+// it to sim.World. It only helps for worlds with several islands that are awake at the same time.
+//
+// Returns false if ODE was built without threading support, the world then keeps stepping on the calling thread.
+// CloseODE detaches and frees the threading implementation.
+bool EnableIslandThreading(Simulation& sim, unsigned num_threads);
+void DisableIslandThreading(Simulation& sim);
+
+#endif
@@ -0,0 +1,114 @@
+#include "material.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+void AddDefaultMaterials(MaterialTable& table)
+{
+    Material m;
+    m.Name = "default";
+    AddMaterial(table, m);
+
+    m.Name = "rubber";
+    m.Density = 1.1;
+    m.Friction = 1.0;
+    m.Bounce = 0.8;
+    m.BounceVel = 0.05;
+    m.SoftCFM = 0.001;
+    AddMaterial(table, m);
+
+    m.Name = "steel";
+    m.Density = 7.8;
+    m.Friction = 0.5;
+    m.Bounce = 0.3;
+    m.BounceVel = 0.1;
+    m.SoftCFM = 1e-5;
+    AddMaterial(table, m);
+
+    m.Name = "ice";
+    m.Density = 0.9;
+    m.Friction = 0.02;
+    m.Bounce = 0.05;
+    m.BounceVel = 0.1;
+    m.SoftCFM = 1e-4;
+    AddMaterial(table, m);
+}
+
+MaterialID AddMaterial(MaterialTable& table, const Material& material)
+{
+    if (table.Materials.size() >= MAX_MATERIALS)
+    {
+        std::cerr << "[AddMaterial] The table is full, '" << material.Name << "' was not added" << std::endl;
+        return NO_MATERIAL;
+    }
+
+    table.Materials.push_back(material);
+    return (MaterialID)(table.Materials.size() - 1);
+}
+
+bool FindMaterial(const MaterialTable& table, const std::string& name, MaterialID& id)
+{
+    for(size_t i = 0; i < table.Materials.size(); ++i)
+    {
+        if (table.Materials[i].Name == name)
+        {
+            id = (MaterialID)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void SetMaterialPairSurface(MaterialTable& table, MaterialID a, MaterialID b, const dSurfaceParameters& surface)
+{
+    MaterialTable::Override o;
+    o.A = a;
+    o.B = b;
+    o.Surface = surface;
+    table.Overrides.push_back(o);
+}
+
+void BuildSurfaces(MaterialTable& table)
+{
+    size_t n = table.Materials.size();
+    table.Surfaces.resize(n * n);
+
+    for(size_t a = 0; a < n; ++a)
+    {
+        for(size_t b = 0; b < n; ++b)
+        {
+            const Material& ma = table.Materials[a];
+            const Material& mb = table.Materials[b];
+
+            dSurfaceParameters& s = table.Surfaces[a * n + b];
+            std::memset(&s, 0, sizeof(s));
+            s.mode = dContactBounce | dContactSoftCFM;
+
+            // Friction is the geometric mean, an infinite coefficient defers to the other material so that ice on a
+            // no-slip default surface still slides
+            if (ma.Friction >= dInfinity)
+                s.mu = mb.Friction;
+            else if (mb.Friction >= dInfinity)
+                s.mu = ma.Friction;
+            else
+                s.mu = std::sqrt(ma.Friction * mb.Friction);
+
+            // The bouncier and the softer of the two materials win
+            s.bounce = std::max(ma.Bounce, mb.Bounce);
+            s.bounce_vel = std::min(ma.BounceVel, mb.BounceVel);
+            s.soft_cfm = std::max(ma.SoftCFM, mb.SoftCFM);
+        }
+    }
+
+    for(size_t i = 0; i < table.Overrides.size(); ++i)
+    {
+        const MaterialTable::Override& o = table.Overrides[i];
+        if (o.A >= n || o.B >= n)
+            continue;
+
+        table.Surfaces[o.A * n + o.B] = o.Surface;
+        table.Surfaces[o.B * n + o.A] = o.Surface;
+    }
+}
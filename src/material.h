@@ -0,0 +1,81 @@
+#ifndef ODE_EXAMPLE_MATERIAL_H
+#define ODE_EXAMPLE_MATERIAL_H
+
+#define dDOUBLE
+#include <ode/ode.h>
+
+#include <cassert>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Every geom carries a material id in its user data (see SetGeomMaterial). The contact surface for a pair of
+// materials is combined once by BuildSurfaces into a dense matrix, so the near callback resolves a pair with a single
+// indexed load and never computes surface parameters itself.
+
+typedef uint16_t MaterialID;
+
+// What AddMaterial returns once every id is taken, never the id of a material
+const MaterialID NO_MATERIAL = 0xffff;
+const size_t MAX_MATERIALS = NO_MATERIAL;
+
+struct Material
+{
+    std::string Name;
+    dReal Density;    // used for the mass of bodies made of this material
+    dReal Friction;   // Coulomb friction coefficient, dInfinity for no slip
+    dReal Bounce;     // restitution, 0 .. 1
+    dReal BounceVel;  // minimum incoming velocity needed to bounce
+    dReal SoftCFM;    // contact softness
+
+    Material() : Density(0.5), Friction(dInfinity), Bounce(0.01), BounceVel(0.1), SoftCFM(0.01) {}
+};
+
+struct MaterialTable
+{
+    std::vector<Material> Materials;
+
+    // Explicit surfaces for specific pairs, these win over the combined ones
+    struct Override { MaterialID A, B; dSurfaceParameters Surface; };
+    std::vector<Override> Overrides;
+
+    // Surfaces[a * Materials.size() + b], filled by BuildSurfaces
+    std::vector<dSurfaceParameters> Surfaces;
+};
+
+// Material 0 ("default") matches the surface and density the example always used. Also adds "rubber", "steel" and
+// "ice".
+void AddDefaultMaterials(MaterialTable& table);
+
+// The id of the new material, NO_MATERIAL if the table already holds MAX_MATERIALS
+MaterialID AddMaterial(MaterialTable& table, const Material& material);
+
+// Returns false if there is no material with that name
+bool FindMaterial(const MaterialTable& table, const std::string& name, MaterialID& id);
+
+// Uses 'surface' for contacts between a and b instead of the combination of the two materials
+void SetMaterialPairSurface(MaterialTable& table, MaterialID a, MaterialID b, const dSurfaceParameters& surface);
+
+// Combines every pair of materials into the surface matrix. Must be called after the last material or override was
+// added and before the table is used for collisions.
+void BuildSurfaces(MaterialTable& table);
+
+// An id the table does not know, from a geom whose user data is not a material, is taken as material 0
+inline const dSurfaceParameters& LookupSurface(const MaterialTable& table, MaterialID a, MaterialID b)
+{
+    size_t n = table.Materials.size();
+    return table.Surfaces[(a < n ? a : 0) * n + (b < n ? b : 0)];
+}
+
+inline void SetGeomMaterial(dGeomID geom, MaterialID material)
+{
+    assert(material != NO_MATERIAL && "the result of a failed AddMaterial");
+    dGeomSetData(geom, (void*)(uintptr_t)material);
+}
+
+inline MaterialID GetGeomMaterial(dGeomID geom)
+{
+    return (MaterialID)(uintptr_t)dGeomGetData(geom);
+}
+
+#endif
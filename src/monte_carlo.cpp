@@ -0,0 +1,397 @@
+#include "monte_carlo.h"
+#include "rewind.h"
+#include "simulation.h"
+#include "thread_pool.h"
+#include "world_pool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+double Distribution::Sample(RandomStream& random) const
+{
+    switch (Type)
+    {
+    case UNIFORM:
+        return random.Uniform(A, B);
+    case NORMAL:
+    {
+        // Box-Muller, 1 - u keeps the logarithm away from 0
+        double u1 = 1.0 - random.NextReal();
+        double u2 = random.NextReal();
+        return A + B * std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * M_PI * u2);
+    }
+    case FIXED:
+    default:
+        return A;
+    }
+}
+
+bool Distribution::Parse(const std::string& text, Distribution& out)
+{
+    std::string kind = text.substr(0, text.find(':'));
+    double values[2] = { 0, 0 };
+    int num_values = 0;
+
+    size_t pos = text.find(':');
+    while (pos != std::string::npos && num_values < 2)
+    {
+        const char* start = text.c_str() + pos + 1;
+        char* end;
+        values[num_values++] = std::strtod(start, &end);
+        if (end == start || (*end != ':' && *end != 0))
+            return false;
+        pos = text.find(':', pos + 1);
+    }
+    if (pos != std::string::npos)
+        return false;
+
+    if (kind == "fixed" && num_values == 1)
+        out = Distribution(FIXED, values[0]);
+    else if (kind == "uniform" && num_values == 2)
+        out = Distribution(UNIFORM, values[0], values[1]);
+    else if (kind == "normal" && num_values == 2)
+        out = Distribution(NORMAL, values[0], values[1]);
+    else
+        return false;
+    return out.IsValid();
+}
+
+bool Distribution::IsValid() const
+{
+    if (!std::isfinite(A) || !std::isfinite(B))
+        return false;
+    if (Type == UNIFORM)
+        return B >= A;
+    if (Type == NORMAL)
+        return B >= 0;
+    return true;
+}
+
+bool Distribution::IsPositive() const
+{
+    if (!IsValid())
+        return false;
+    return A > 0 && (Type != NORMAL || B == 0);
+}
+
+std::string Distribution::ToString() const
+{
+    std::ostringstream s;
+    s.precision(17);
+    if (Type == FIXED)
+        s << "fixed:" << A;
+    else
+        s << (Type == UNIFORM ? "uniform:" : "normal:") << A << ":" << B;
+    return s.str();
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void MonteCarloStats::Merge(const MonteCarloStats& other)
+{
+    if (other.Settled > 0)
+    {
+        if (Settled == 0)
+        {
+            RestTimeMin = other.RestTimeMin;
+            RestTimeMax = other.RestTimeMax;
+        }
+        else
+        {
+            RestTimeMin = std::min(RestTimeMin, other.RestTimeMin);
+            RestTimeMax = std::max(RestTimeMax, other.RestTimeMax);
+        }
+
+        double n = (double)(Settled + other.Settled);
+        double delta = other.RestTimeMean - RestTimeMean;
+        RestTimeMean += delta * other.Settled / n;
+        RestTimeM2 += other.RestTimeM2 + delta * delta * ((double)Settled * other.Settled / n);
+    }
+
+    Samples += other.Samples;
+    Settled += other.Settled;
+    Contacts += other.Contacts;
+    MaxContacts = std::max(MaxContacts, other.MaxContacts);
+    OutsidePosition += other.OutsidePosition;
+
+    for(int i = 0; i < 6; ++i)
+        FaceUp[i] += other.FaceUp[i];
+
+    RestTimeHistogram.resize(std::max(RestTimeHistogram.size(), other.RestTimeHistogram.size()));
+    for(size_t i = 0; i < other.RestTimeHistogram.size(); ++i)
+        RestTimeHistogram[i] += other.RestTimeHistogram[i];
+
+    PositionHistogram.resize(std::max(PositionHistogram.size(), other.PositionHistogram.size()));
+    for(size_t i = 0; i < other.PositionHistogram.size(); ++i)
+        PositionHistogram[i] += other.PositionHistogram[i];
+}
+
+namespace
+{
+
+// Empties stats but keeps the histogram memory
+void ResetStats(const MonteCarloConfig& config, MonteCarloStats& stats)
+{
+    std::vector<uint64_t> rest_time, position;
+    rest_time.swap(stats.RestTimeHistogram);
+    position.swap(stats.PositionHistogram);
+
+    stats = MonteCarloStats();
+
+    rest_time.assign(config.RestTimeBins, 0);
+    position.assign(config.PositionBins * config.PositionBins, 0);
+    rest_time.swap(stats.RestTimeHistogram);
+    position.swap(stats.PositionHistogram);
+}
+
+int Bin(double value, double lo, double hi, unsigned bins)
+{
+    if (!(value >= lo && value < hi))
+        return -1;
+    return std::min((int)((value - lo) / (hi - lo) * bins), (int)bins - 1);
+}
+
+void RunSample(Simulation& sim, const WorldState& initial, const MonteCarloConfig& config, uint64_t sample,
+               MonteCarloStats& stats)
+{
+    ResetWorldInPlace(sim, initial);
+
+    // Always drawn in the same order, so sample n gets the same parameters in every run with the same run id
+    RandomStream random(config.RunId, sample);
+    Distribution normal(Distribution::NORMAL, 0, 1);
+
+    // A normally distributed vector points in a uniformly distributed direction
+    dReal axis[3];
+    for(int k = 0; k < 3; ++k)
+        axis[k] = normal.Sample(random);
+    if (axis[0] == 0 && axis[1] == 0 && axis[2] == 0)
+        axis[1] = 1;
+
+    dReal angle = config.Angle.Sample(random);
+    dReal height = config.Height.Sample(random);
+    dReal vx = config.VelocityX.Sample(random);
+    dReal vy = config.VelocityY.Sample(random);
+    dReal vz = config.VelocityZ.Sample(random);
+    dReal density = config.Density.Sample(random);
+
+    dBodyID box = sim.Objects[0].Body;
+    const dReal* p0 = &initial.Position[0];
+
+    dMatrix3 R;
+    dRFromAxisAndAngle(R, axis[0], axis[1], axis[2], angle);
+    dBodySetRotation(box, R);
+    dBodySetPosition(box, p0[0], height, p0[2]);
+    dBodySetLinearVel(box, vx, vy, vz);
+
+    dVector3 sides;
+    dGeomBoxGetLengths(sim.Objects[0].Geom[0], sides);
+    dMass m;
+    dMassSetBox(&m, density, sides[0], sides[1], sides[2]);
+    dBodySetMass(box, &m);
+
+    uint64_t contacts = sim.ContactCount;
+    RunSteps(sim, config.TimeStep, config.MaxSteps, REST_STOP);
+    contacts = sim.ContactCount - contacts;
+
+    ++stats.Samples;
+    stats.Contacts += contacts;
+    stats.MaxContacts = std::max(stats.MaxContacts, contacts);
+
+    if (sim.RestStep != NOT_AT_REST)
+    {
+        double t = sim.RestStep * config.TimeStep;
+        if (stats.Settled == 0)
+            stats.RestTimeMin = stats.RestTimeMax = t;
+        stats.RestTimeMin = std::min(stats.RestTimeMin, t);
+        stats.RestTimeMax = std::max(stats.RestTimeMax, t);
+
+        ++stats.Settled;
+        double delta = t - stats.RestTimeMean;
+        stats.RestTimeMean += delta / stats.Settled;
+        stats.RestTimeM2 += delta * (t - stats.RestTimeMean);
+
+        int bin = Bin(t, 0, config.MaxSteps * config.TimeStep, config.RestTimeBins);
+        if (bin >= 0)
+            ++stats.RestTimeHistogram[bin];
+    }
+
+    // The body axis that ends up most vertical tells which face is on top. Column k of R is body axis k.
+    const dReal* rotation = dBodyGetRotation(box);
+    int axis_up = 0;
+    for(int k = 1; k < 3; ++k)
+    {
+        if (std::fabs(rotation[4 + k]) > std::fabs(rotation[4 + axis_up]))
+            axis_up = k;
+    }
+    ++stats.FaceUp[2 * axis_up + (rotation[4 + axis_up] < 0 ? 1 : 0)];
+
+    const dReal* p = dBodyGetPosition(box);
+    int x = Bin(p[0] - p0[0], -config.PositionRange, config.PositionRange, config.PositionBins);
+    int z = Bin(p[2] - p0[2], -config.PositionRange, config.PositionRange, config.PositionBins);
+    if (x >= 0 && z >= 0)
+        ++stats.PositionHistogram[z * config.PositionBins + x];
+    else
+        ++stats.OutsidePosition;
+}
+
+// A list, or a list of rows of 'row' entries each
+void WriteHistogram(std::FILE* f, const std::vector<uint64_t>& histogram, size_t row)
+{
+    std::fprintf(f, "[");
+    for(size_t i = 0; i < histogram.size(); ++i)
+    {
+        if (row && i % row == 0)
+            std::fprintf(f, "%s\n    [", i ? "]," : "");
+        else if (i)
+            std::fprintf(f, ", ");
+        std::fprintf(f, "%llu", (unsigned long long)histogram[i]);
+    }
+    if (row && !histogram.empty())
+        std::fprintf(f, "]\n  ");
+    std::fprintf(f, "]");
+}
+
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+bool WriteMonteCarloStats(const std::string& path, const MonteCarloConfig& config, const MonteCarloStats& stats)
+{
+    // Written next to the target and renamed over it, readers never see a half written file
+    std::string tmp = path + ".tmp";
+    std::FILE* f = std::fopen(tmp.c_str(), "w");
+    if (!f)
+    {
+        std::cerr << "[WriteMonteCarloStats] Could not open '" << tmp << "': " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    double stddev = stats.Settled > 1 ? std::sqrt(stats.RestTimeM2 / (stats.Settled - 1)) : 0;
+
+    std::fprintf(f, "{\n");
+    std::fprintf(f, "  \"run_id\": %llu,\n", (unsigned long long)config.RunId);
+    std::fprintf(f, "  \"samples\": %llu,\n", (unsigned long long)stats.Samples);
+    std::fprintf(f, "  \"samples_requested\": %llu,\n", (unsigned long long)config.Samples);
+    std::fprintf(f, "  \"time_step\": %.17g,\n  \"max_steps\": %llu,\n", config.TimeStep,
+                 (unsigned long long)config.MaxSteps);
+    std::fprintf(f, "  \"distributions\": { \"angle\": \"%s\", \"height\": \"%s\", \"velocity_x\": \"%s\", "
+                    "\"velocity_y\": \"%s\", \"velocity_z\": \"%s\", \"density\": \"%s\" },\n",
+                 config.Angle.ToString().c_str(), config.Height.ToString().c_str(),
+                 config.VelocityX.ToString().c_str(), config.VelocityY.ToString().c_str(),
+                 config.VelocityZ.ToString().c_str(), config.Density.ToString().c_str());
+    std::fprintf(f, "  \"settled\": %llu,\n", (unsigned long long)stats.Settled);
+    std::fprintf(f, "  \"rest_time\": { \"mean\": %.17g, \"stddev\": %.17g, \"min\": %.17g, \"max\": %.17g, "
+                    "\"histogram_max\": %.17g, \"histogram\": ",
+                 stats.RestTimeMean, stddev, stats.RestTimeMin, stats.RestTimeMax,
+                 config.MaxSteps * config.TimeStep);
+    WriteHistogram(f, stats.RestTimeHistogram, 0);
+    std::fprintf(f, " },\n");
+    std::fprintf(f, "  \"contacts\": { \"total\": %llu, \"mean\": %.17g, \"max\": %llu },\n",
+                 (unsigned long long)stats.Contacts, stats.Samples ? (double)stats.Contacts / stats.Samples : 0.0,
+                 (unsigned long long)stats.MaxContacts);
+    std::fprintf(f, "  \"face_up\": { \"+x\": %llu, \"-x\": %llu, \"+y\": %llu, \"-y\": %llu, \"+z\": %llu, "
+                    "\"-z\": %llu },\n",
+                 (unsigned long long)stats.FaceUp[0], (unsigned long long)stats.FaceUp[1],
+                 (unsigned long long)stats.FaceUp[2], (unsigned long long)stats.FaceUp[3],
+                 (unsigned long long)stats.FaceUp[4], (unsigned long long)stats.FaceUp[5]);
+    std::fprintf(f, "  \"position_range\": %.17g,\n  \"position_outside\": %llu,\n", config.PositionRange,
+                 (unsigned long long)stats.OutsidePosition);
+    std::fprintf(f, "  \"position_histogram\": ");
+    WriteHistogram(f, stats.PositionHistogram, config.PositionBins);
+    std::fprintf(f, "\n}\n");
+
+    bool ok = std::fclose(f) == 0;
+    if (ok && std::rename(tmp.c_str(), path.c_str()) != 0)
+        ok = false;
+    if (!ok)
+        std::cerr << "[WriteMonteCarloStats] Could not write '" << path << "'" << std::endl;
+    return ok;
+}
+
+const char* MonteCarloConfigError(const MonteCarloConfig& config)
+{
+    if (!(config.TimeStep > 0) || !std::isfinite(config.TimeStep))
+        return "time step must be positive";
+    if (config.PositionBins == 0 || config.RestTimeBins == 0)
+        return "bin counts must be positive";
+    if (config.PositionBins > 65535)
+        return "too many position bins";  // PositionBins squared has to fit
+    if (!(config.PositionRange > 0) || !std::isfinite(config.PositionRange))
+        return "position range must be positive";
+
+    const Distribution* distributions[] = { &config.Angle, &config.Height, &config.VelocityX, &config.VelocityY,
+                                            &config.VelocityZ, &config.Density };
+    for(size_t i = 0; i < sizeof(distributions) / sizeof(distributions[0]); ++i)
+    {
+        if (!distributions[i]->IsValid())
+            return "invalid distribution";
+    }
+    if (!config.Density.IsPositive())
+        return "density distribution must be positive";
+    return 0;
+}
+
+bool RunMonteCarlo(const MonteCarloConfig& config, ThreadPool& pool, const std::string& output_path,
+                   MonteCarloStats& stats)
+{
+    if (const char* error = MonteCarloConfigError(config))
+    {
+        std::cerr << "[RunMonteCarlo] " << error << std::endl;
+        stats = MonteCarloStats();
+        return false;
+    }
+
+    ResetStats(config, stats);
+
+    // One world per thread, reset before every sample. They are built on the calling thread before the pool starts.
+    unsigned num_threads = pool.NumThreads();
+    std::vector<Simulation> worlds(num_threads);
+    std::vector<WorldState> initial(num_threads);
+    for(unsigned t = 0; t < num_threads; ++t)
+    {
+        InitODE(worlds[t]);
+        CaptureWorldState(worlds[t], initial[t]);
+    }
+
+    uint64_t block_size = std::max<uint64_t>(config.BlockSize, 1);
+    uint64_t num_blocks = (config.Samples + block_size - 1) / block_size;
+
+    // Enough blocks per round to keep every thread busy, few enough to write results regularly
+    size_t round_blocks = std::max<size_t>(16 * num_threads, 1);
+    std::vector<MonteCarloStats> block_stats(round_blocks);
+
+    bool ok = true;
+    for(uint64_t first = 0; first < num_blocks; first += round_blocks)
+    {
+        size_t count = (size_t)std::min<uint64_t>(round_blocks, num_blocks - first);
+
+        pool.ParallelFor(count, [&](size_t j, unsigned thread)
+        {
+            MonteCarloStats& s = block_stats[j];
+            ResetStats(config, s);
+
+            uint64_t begin = (first + j) * block_size;
+            uint64_t end = std::min(begin + block_size, config.Samples);
+            for(uint64_t sample = begin; sample < end; ++sample)
+                RunSample(worlds[thread], initial[thread], config, sample, s);
+        });
+
+        // In block order, so the floating point sums do not depend on which thread finished first
+        for(size_t j = 0; j < count; ++j)
+            stats.Merge(block_stats[j]);
+
+        if (!output_path.empty())
+            ok = WriteMonteCarloStats(output_path, config, stats) && ok;
+    }
+
+    for(unsigned t = 0; t < num_threads; ++t)
+        CloseODE(worlds[t]);
+
+    return ok;
+}
@@ -0,0 +1,126 @@
+#ifndef ODE_EXAMPLE_MONTE_CARLO_H
+#define ODE_EXAMPLE_MONTE_CARLO_H
+
+#include "random_stream.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Monte Carlo study of the example: many drops of the box, each with its own initial rotation, height, velocity and
+// density drawn from configurable distributions. Only aggregated statistics are kept, no trajectories.
+//
+// Sample n draws from RandomStream(run id, n) and is simulated in a world that is reset in place (see
+// ResetWorldInPlace), so its parameters do not depend on the thread that ran it. Statistics are gathered per block
+// of samples and merged in block order, so neither does the order of the floating point sums.
+//
+// The results are still only bit-reproducible for samples that never touch anything, or with one thread in a fresh
+// process: ODE's QuickStep shuffles the contact constraints with dRandInt, whose state is process wide, so once boxes
+// hit the ground, whatever else has stepped before (worlds on other threads, earlier runs) changes what a sample
+// draws. Such runs agree statistically, not bit for bit.
+
+struct Distribution
+{
+    enum Kind
+    {
+        FIXED,    // always A
+        UNIFORM,  // in [A, B)
+        NORMAL    // mean A, standard deviation B
+    };
+
+    Kind Type;
+    double A;
+    double B;
+
+    Distribution(Kind type = FIXED, double a = 0, double b = 0) : Type(type), A(a), B(b) {}
+
+    double Sample(RandomStream& random) const;
+
+    // "fixed:a", "uniform:lo:hi" or "normal:mean:stddev". Fails on anything IsValid rejects.
+    static bool Parse(const std::string& text, Distribution& out);
+
+    // Finite parameters, lo <= hi and stddev >= 0
+    bool IsValid() const;
+
+    // Every sample is > 0, which a normal distribution only guarantees with a stddev of 0
+    bool IsPositive() const;
+
+    std::string ToString() const;
+};
+
+struct MonteCarloConfig
+{
+    uint64_t Samples;
+    uint64_t RunId;
+    double TimeStep;
+    uint64_t MaxSteps;  // a sample that is not at rest after this many steps counts as not settled
+
+    // The rotation axis is uniform on the sphere, the angle (radians) and the rest come from these
+    Distribution Angle;
+    Distribution Height;
+    Distribution VelocityX;
+    Distribution VelocityY;
+    Distribution VelocityZ;
+    Distribution Density;  // must be positive, see Distribution::IsPositive
+
+    // Final (x, z) position histogram, PositionBins x PositionBins over +-PositionRange around the drop point
+    unsigned PositionBins;
+    double PositionRange;
+
+    unsigned RestTimeBins;  // over [0, MaxSteps * TimeStep]
+
+    uint64_t BlockSize;  // samples per unit of work, also the granularity of the result
+
+    MonteCarloConfig()
+        : Samples(100000), RunId(0), TimeStep(0.01), MaxSteps(1000), Angle(Distribution::UNIFORM, -5, 5),
+          Height(Distribution::FIXED, 10), VelocityX(Distribution::FIXED, 0), VelocityY(Distribution::FIXED, 0),
+          VelocityZ(Distribution::FIXED, 0), Density(Distribution::FIXED, 0.5), PositionBins(32), PositionRange(8),
+          RestTimeBins(50), BlockSize(256) {}
+};
+
+struct MonteCarloStats
+{
+    uint64_t Samples;
+    uint64_t Settled;  // came to rest within MaxSteps
+
+    // Time to rest of the settled samples, mean and sum of squared deviations (merged with Chan's formula)
+    double RestTimeMean;
+    double RestTimeM2;
+    double RestTimeMin;
+    double RestTimeMax;
+    std::vector<uint64_t> RestTimeHistogram;
+
+    uint64_t Contacts;     // contact joints over all steps of all samples
+    uint64_t MaxContacts;  // most contact joints of a single sample
+
+    // Which face of the box points up at the end: +x, -x, +y, -y, +z, -z of the body
+    uint64_t FaceUp[6];
+
+    std::vector<uint64_t> PositionHistogram;  // row major, z rows, x columns
+    uint64_t OutsidePosition;                 // final positions outside the histogram
+
+    MonteCarloStats() : Samples(0), Settled(0), RestTimeMean(0), RestTimeM2(0), RestTimeMin(0), RestTimeMax(0),
+                        Contacts(0), MaxContacts(0), OutsidePosition(0)
+    {
+        for(int i = 0; i < 6; ++i)
+            FaceUp[i] = 0;
+    }
+
+    void Merge(const MonteCarloStats& other);
+};
+
+// What is wrong with the config, 0 if nothing
+const char* MonteCarloConfigError(const MonteCarloConfig& config);
+
+// Runs the samples on the pool. After every round of blocks the statistics so far are written to output_path (if
+// not empty) as JSON, replacing the previous file atomically, so a long run can be watched and an interrupted run
+// still leaves a consistent partial result. Returns false if the config is invalid (nothing is run then) or the output
+// could not be written.
+bool RunMonteCarlo(const MonteCarloConfig& config, ThreadPool& pool, const std::string& output_path,
+                   MonteCarloStats& stats);
+
+bool WriteMonteCarloStats(const std::string& path, const MonteCarloConfig& config, const MonteCarloStats& stats);
+
+#endif
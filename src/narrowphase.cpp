@@ -0,0 +1,98 @@
+#include "narrowphase.h"
+#include "simulation.h"
+#include "thread_pool.h"
+
+namespace
+{
+
+// Broadphase callback that only remembers the pair
+void GatherCallback(void* data, dGeomID o1, dGeomID o2)
+{
+    if (dGeomIsSpace(o1) || dGeomIsSpace(o2))
+    {
+        dSpaceCollide2(o1, o2, data, &GatherCallback);
+        return;
+    }
+
+    NarrowphaseBuffers::Pair pair = { o1, o2 };
+    static_cast<NarrowphaseBuffers*>(data)->Pairs.push_back(pair);
+}
+
+}
+
+void CollideParallel(Simulation& sim, ThreadPool& pool)
+{
+    NarrowphaseBuffers& buffers = sim.Narrowphase;
+
+    // Broadphase, exactly the same pairs SimLoop would test, in the same order
+    buffers.Pairs.clear();
+    dSpaceCollide(sim.Space, &buffers, &GatherCallback);
+    dSpaceCollide2((dGeomID)sim.Space, (dGeomID)sim.StaticSpace, &buffers, &GatherCallback);
+
+    size_t num_pairs = buffers.Pairs.size();
+    if (num_pairs == 0)
+        return;
+
+    buffers.Results.resize(num_pairs);
+    if (buffers.Threads.size() < pool.NumThreads())
+        buffers.Threads.resize(pool.NumThreads());
+    for(size_t t = 0; t < buffers.Threads.size(); ++t)
+        buffers.Threads[t].Used = 0;
+
+    StepProfile* profile = sim.Profile;
+    double t_collide = profile ? ProfileClock() : 0;
+
+    // Narrowphase. Most pairs are cheap, so hand them out in chunks to keep the scheduling overhead down.
+    pool.ParallelFor(num_pairs, [&buffers](size_t i, unsigned thread)
+    {
+        NarrowphaseBuffers::ThreadBuffer& out = buffers.Threads[thread];
+        if (out.Contacts.size() < out.Used + MAX_CONTACTS)
+            out.Contacts.resize(2 * (out.Used + MAX_CONTACTS));
+
+        const NarrowphaseBuffers::Pair& pair = buffers.Pairs[i];
+        int n = dCollide(pair.O1, pair.O2, MAX_CONTACTS, &out.Contacts[out.Used], sizeof(dContactGeom));
+
+        NarrowphaseBuffers::Result& result = buffers.Results[i];
+        result.Thread = thread;
+        result.Count = n;
+        result.Offset = out.Used;
+
+        out.Used += n;
+    }, 16);
+
+    double t_contacts = profile ? ProfileClock() : 0;
+    size_t num_contacts = 0;
+
+    // Create the contact joints in pair order, see nearCallback for what happens here
+    dContact contact;
+    for(size_t i = 0; i < num_pairs; ++i)
+    {
+        const NarrowphaseBuffers::Result& result = buffers.Results[i];
+        if (result.Count == 0)
+            continue;
+
+        const NarrowphaseBuffers::Pair& pair = buffers.Pairs[i];
+        dBodyID b1 = dGeomGetBody(pair.O1);
+        dBodyID b2 = dGeomGetBody(pair.O2);
+
+        contact.surface = LookupSurface(sim.Materials, GetGeomMaterial(pair.O1), GetGeomMaterial(pair.O2));
+
+        num_contacts += result.Count;
+        const dContactGeom* geoms = &buffers.Threads[result.Thread].Contacts[result.Offset];
+        for(unsigned j = 0; j < result.Count; ++j)
+        {
+            contact.geom = geoms[j];
+            dJointID c = dJointCreateContact(sim.World, sim.contactgroup, &contact);
+            dJointAttach(c, b1, b2);
+        }
+    }
+    sim.ContactCount += num_contacts;
+
+    if (profile)
+    {
+        profile->Seconds[PHASE_NARROWPHASE] += t_contacts - t_collide;
+        profile->Seconds[PHASE_CONTACTS] += ProfileClock() - t_contacts;
+        profile->Pairs += num_pairs;
+        profile->Contacts += num_contacts;
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef ODE_EXAMPLE_NARROWPHASE_H
+#define ODE_EXAMPLE_NARROWPHASE_H
+
+#define dDOUBLE
+#include <ode/ode.h>
+
+#include <cstddef>
+#include <vector>
+
+struct Simulation;
+class ThreadPool;
+
+// Maximum number of contact points dCollide may return for a single pair of geoms
+const int MAX_CONTACTS = 10;
+
+// Parallel narrowphase. Instead of running dCollide from inside the dSpaceCollide callback, the candidate pairs are
+// gathered first and dCollide runs for all of them on the threads of a ThreadPool, each thread writing into its own
+// contact buffer. The contact joints are then created on the calling thread in the order the broadphase reported the
+// pairs, so the result does not depend on the number of threads or on how the pairs were distributed over them.
+//
+// All buffers are kept between steps, once they have grown to the size a scene needs no more memory is allocated.
+struct NarrowphaseBuffers
+{
+    struct Pair
+    {
+        dGeomID O1, O2;
+    };
+
+    // Where the contacts of a pair ended up
+    struct Result
+    {
+        unsigned Thread;
+        unsigned Count;
+        size_t Offset;
+    };
+
+    // Padded so two threads never write to the same cache line
+    struct ThreadBuffer
+    {
+        std::vector<dContactGeom> Contacts;
+        size_t Used;
+        char Padding[64];
+    };
+
+    std::vector<Pair> Pairs;
+    std::vector<Result> Results;
+    std::vector<ThreadBuffer> Threads;
+};
+
+// Does what dSpaceCollide with nearCallback does in SimLoop, but with the dCollide calls spread over the pool.
+// The pool must not be the one that is running this SimLoop (as in BatchSimulation), jobs can not be nested.
+void CollideParallel(Simulation& sim, ThreadPool& pool);
+
+#endif
@@ -0,0 +1,64 @@
+// Runs many copies of the example scene at once. Every copy only differs by its random initial rotation, unless
+// the worlds are cloned from a single example world, then they are all the same.
+//
+//     ode_batch [num_worlds] [num_threads] [num_steps] [init|clone]
+
+#include "batch.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    size_t num_worlds = argc > 1 ? std::strtoul(argv[1], 0, 10) : 1000;
+    unsigned num_threads = argc > 2 ? std::strtoul(argv[2], 0, 10) : 0;
+    int num_steps = argc > 3 ? std::atoi(argv[3]) : 1000;
+    bool clone = argc > 4 && std::string(argv[4]) == "clone";
+
+    dInitODE2(0);
+
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        std::unique_ptr<BatchSimulation> batch_ptr;
+        if (clone)
+        {
+            Simulation source;
+            InitODE(source);
+            batch_ptr.reset(new BatchSimulation(WorldTemplate(source), num_worlds, num_threads));
+            CloseODE(source);
+        }
+        else
+            batch_ptr.reset(new BatchSimulation(num_worlds, num_threads));
+        BatchSimulation& batch = *batch_ptr;
+
+        double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+
+        int steps = 0;
+        while (steps < num_steps && !batch.AllAtRest())
+        {
+            batch.Step(0.01);
+            ++steps;
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double rest_time = 0;
+        for(size_t i = 0; i < batch.NumWorlds(); ++i)
+        {
+            uint64_t rest_step = batch.World(i).RestStep;
+            rest_time += rest_step != NOT_AT_REST ? rest_step * 0.01 : num_steps * 0.01;
+        }
+
+        std::cout << num_worlds << " worlds, " << batch.Pool().NumThreads() << " threads, " << steps << " steps: "
+                  << seconds << " s (" << (num_worlds * steps) / seconds << " world steps / s), mean time to rest "
+                  << rest_time / num_worlds << " s, built in " << build_seconds << " s\n";
+    }
+
+    dCloseODE();
+}
@@ -0,0 +1,349 @@
+// Step loop benchmark. Drops a pile of boxes on the ground and records how long every phase of every SimLoop call
+// takes (see StepProfile). Reports mean, p50, p99 and max per phase and for the whole step, as JSON or CSV, so runs
+// against different ODE builds can be compared by a script.
+//
+//     ode_bench [--bodies N] [--steps N] [--warmup N] [--broadphase simple|hash|sap|quadtree]
+//               [--narrowphase-threads N] [--island-threads N] [--ballistic 0|1] [--seed N] [--format json|csv]
+//               [--scene file] [--snapshot file] [--ode-allocator 0|1] [--huge-pages 0|1]
+//               [--step-reserve-factor F] [--step-reserve-min BYTES] [--step-memory-learn N] [--step-memory-stats 0|1]
+//
+// With --scene the world is loaded from a scene file (see scene.h) instead of the pile, --bodies and --broadphase are
+// then ignored. --snapshot restores a snapshot taken of the same world (see snapshot.h) before the first step.
+// --ode-allocator installs the pooled allocator for ODE's memory (see allocator.h), the JSON output then also shows
+// how much ODE allocated per step, how far above its starting point the memory in use rose within each step, and
+// how many of those allocations went to the system. The --step-* options set
+// the reservation policy of dWorldQuickStep's arena (see step_memory.h), --step-memory-learn runs that many steps
+// first to size the arena, --step-memory-stats reports the arena size after every measured step and the steps that
+// had to reallocate it.
+
+#include "allocator.h"
+#include "island_threading.h"
+#include "scene.h"
+#include "simulation.h"
+#include "snapshot.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+struct BenchConfig
+{
+    size_t Bodies;
+    int Steps;
+    int Warmup;
+    BroadphaseConfig Broadphase;
+    unsigned NarrowphaseThreads;
+    unsigned IslandThreads;
+    bool Ballistic;
+    unsigned long Seed;
+    std::string Format;
+    std::string Scene;
+    std::string Snapshot;
+    bool OdeAllocator;
+    bool HugePages;
+    StepMemoryConfig StepMemory;
+    unsigned StepMemoryLearn;
+
+    BenchConfig() : Bodies(1000), Steps(1000), Warmup(0), NarrowphaseThreads(0), IslandThreads(0), Ballistic(false), Seed(1),
+                    Format("json"), OdeAllocator(false), HugePages(false),
+                    StepMemoryLearn(0)
+    {
+        Broadphase.Type = BROADPHASE_HASH;
+    }
+};
+
+struct Summary
+{
+    double Mean, P50, P99, Max;
+};
+
+Summary Summarize(std::vector<double> samples)
+{
+    Summary s = { 0, 0, 0, 0 };
+    if (samples.empty())
+        return s;
+
+    std::sort(samples.begin(), samples.end());
+    for(size_t i = 0; i < samples.size(); ++i)
+        s.Mean += samples[i];
+    s.Mean /= samples.size();
+    s.P50 = samples[(samples.size() - 1) * 50 / 100];
+    s.P99 = samples[(samples.size() - 1) * 99 / 100];
+    s.Max = samples.back();
+    return s;
+}
+
+bool ParseArgs(int argc, char** argv, BenchConfig& config)
+{
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--bodies")
+            config.Bodies = std::strtoul(value.c_str(), 0, 10);
+        else if (arg == "--steps")
+            config.Steps = std::atoi(value.c_str());
+        else if (arg == "--warmup")
+            config.Warmup = std::atoi(value.c_str());
+        else if (arg == "--narrowphase-threads")
+            config.NarrowphaseThreads = std::strtoul(value.c_str(), 0, 10);
+        else if (arg == "--island-threads")
+            config.IslandThreads = std::strtoul(value.c_str(), 0, 10);
+        else if (arg == "--ballistic")
+            config.Ballistic = std::atoi(value.c_str()) != 0;
+        else if (arg == "--seed")
+            config.Seed = std::strtoul(value.c_str(), 0, 10);
+        else if (arg == "--format")
+            config.Format = value;
+        else if (arg == "--scene")
+            config.Scene = value;
+        else if (arg == "--snapshot")
+            config.Snapshot = value;
+        else if (arg == "--ode-allocator")
+            config.OdeAllocator = std::atoi(value.c_str()) != 0;
+        else if (arg == "--huge-pages")
+            config.HugePages = std::atoi(value.c_str()) != 0;
+        else if (arg == "--step-reserve-factor")
+            config.StepMemory.ReserveFactor = std::atof(value.c_str());
+        else if (arg == "--step-reserve-min")
+            config.StepMemory.ReserveMinimum = std::strtoul(value.c_str(), 0, 10);
+        else if (arg == "--step-memory-learn")
+            config.StepMemoryLearn = std::strtoul(value.c_str(), 0, 10);
+        else if (arg == "--step-memory-stats")
+            config.StepMemory.Instrument = std::atoi(value.c_str()) != 0;
+        else if (arg == "--broadphase")
+        {
+            if (!ParseBroadphase(value, config.Broadphase.Type))
+            {
+                std::cerr << "Unknown broadphase '" << value << "'" << std::endl;
+                return false;
+            }
+        }
+        else
+        {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+    if (config.Format != "json" && config.Format != "csv")
+    {
+        std::cerr << "Unknown format '" << config.Format << "'" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Boxes in columns over a square patch, each with a random orientation, so they fall and pile up
+void BuildPile(Simulation& sim, const BenchConfig& config)
+{
+    RandomStream random(config.Seed);
+
+    CreateWorld(sim, config.Broadphase);
+    AddPlane(sim, 0, 1, 0, 0);
+
+    size_t columns = std::max<size_t>(1, (size_t)std::sqrt((double)config.Bodies / 8));
+    dReal sides[3] = { 1, 1, 1 };
+    for(size_t i = 0; i < config.Bodies; ++i)
+    {
+        size_t column = i % (columns * columns);
+        size_t layer = i / (columns * columns);
+        dReal pos[3] = { (dReal)(column % columns) * 1.5, 1 + (dReal)layer * 1.8, (dReal)(column / columns) * 1.5 };
+
+        dReal axis[3];
+        for(int k = 0; k < 3; ++k)
+            axis[k] = random.Uniform(-1.0, 1.0);
+        dReal angle = random.Uniform(-5.0, 5.0);
+
+        dMatrix3 R;
+        dRFromAxisAndAngle(R, axis[0], axis[1], axis[2], angle);
+        AddBox(sim, pos, sides, R);
+    }
+
+    TuneSpaces(sim);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    BenchConfig config;
+    if (!ParseArgs(argc, argv, config))
+        return 1;
+
+    if (config.OdeAllocator)
+    {
+        AllocConfig alloc;
+        alloc.HugePages = config.HugePages;
+        InstallODEAllocator(alloc);
+    }
+
+    dInitODE2(0);
+
+    StepMemoryStats step_memory;
+    Simulation sim;
+    sim.StepMemory = config.StepMemory;
+    sim.MemoryStats = &step_memory;
+    if (config.Scene.empty())
+        BuildPile(sim, config);
+    else
+    {
+        Scene scene;
+        if (!LoadScene(config.Scene, scene))
+        {
+            dCloseODE();
+            return 1;
+        }
+        BuildScene(sim, scene);
+    }
+
+    if (!config.Snapshot.empty() && !LoadSnapshot(config.Snapshot, sim))
+    {
+        CloseODE(sim);
+        dCloseODE();
+        return 1;
+    }
+    size_t num_bodies = sim.Objects.size();
+    BroadphaseType broadphase = sim.Broadphase.Type;
+
+    std::unique_ptr<ThreadPool> pool;
+    if (config.NarrowphaseThreads > 1)
+    {
+        pool.reset(new ThreadPool(config.NarrowphaseThreads));
+        sim.NarrowphasePool = pool.get();
+    }
+
+    if (config.IslandThreads > 1)
+        EnableIslandThreading(sim, config.IslandThreads);
+
+    sim.BallisticFastForward = config.Ballistic;
+
+    if (config.StepMemoryLearn > 0)
+        LearnStepMemory(sim, 0.01, config.StepMemoryLearn);
+
+    for(int i = 0; i < config.Warmup; ++i)
+        SimLoop(sim, 0.01);
+
+    StepProfile profile;
+    sim.Profile = &profile;
+
+    std::vector<double> samples[NUM_STEP_PHASES + 1];
+    std::vector<double> peak_bytes;  // per step, above what was in use when the step started
+    std::vector<int64_t> arena_bytes;  // per step, dWorldQuickStep's arena after the step
+    uint64_t pairs = 0;
+    uint64_t contacts = 0;
+
+    ResetODEAllocPeak();
+    AllocStats alloc_start = GetODEAllocStats();
+    ResetStepMemoryStats(step_memory);
+    uint64_t first_step = sim.StepCount;
+
+    for(int i = 0; i < config.Steps; ++i)
+    {
+        int64_t in_use = 0;
+        if (config.OdeAllocator)
+        {
+            ResetODEAllocPeak();
+            in_use = GetODEAllocStats().BytesInUse;
+        }
+
+        SimLoop(sim, 0.01);
+
+        if (config.OdeAllocator)
+            peak_bytes.push_back((double)(GetODEAllocStats().PeakBytesInUse - in_use));
+        if (config.StepMemory.Instrument)
+            arena_bytes.push_back(step_memory.ArenaBytes);
+
+        for(int p = 0; p < NUM_STEP_PHASES; ++p)
+            samples[p].push_back(profile.Seconds[p] * 1e6);
+        samples[NUM_STEP_PHASES].push_back(profile.Total() * 1e6);
+        pairs += profile.Pairs;
+        contacts += profile.Contacts;
+    }
+
+    sim.Profile = 0;
+
+    AllocStats alloc_end = GetODEAllocStats();
+    unsigned reserve_minimum = sim.StepMemory.ReserveMinimum;
+    CloseODE(sim);
+    pool.reset();
+
+    const char* ode_config = dGetConfiguration();
+
+    // All times in microseconds
+    if (config.Format == "csv")
+    {
+        std::cout << "phase, mean_us, p50_us, p99_us, max_us\n";
+        for(int p = 0; p <= NUM_STEP_PHASES; ++p)
+        {
+            Summary s = Summarize(samples[p]);
+            std::cout << (p < NUM_STEP_PHASES ? StepPhaseName(p) : "total") << ", " << s.Mean << ", " << s.P50
+                      << ", " << s.P99 << ", " << s.Max << "\n";
+        }
+    }
+    else
+    {
+        std::cout << "{\n"
+                  << "  \"ode_configuration\": \"" << (ode_config ? ode_config : "") << "\",\n"
+                  << "  \"bodies\": " << num_bodies << ",\n"
+                  << "  \"steps\": " << config.Steps << ",\n"
+                  << "  \"warmup\": " << config.Warmup << ",\n"
+                  << "  \"broadphase\": \"" << BroadphaseName(broadphase) << "\",\n"
+                  << "  \"narrowphase_threads\": " << config.NarrowphaseThreads << ",\n"
+                  << "  \"island_threads\": " << config.IslandThreads << ",\n"
+                  << "  \"ballistic\": " << (config.Ballistic ? "true" : "false") << ",\n"
+                  << "  \"seed\": " << config.Seed << ",\n"
+                  << "  \"pairs_per_step\": " << (config.Steps ? pairs / config.Steps : 0) << ",\n"
+                  << "  \"contacts_per_step\": " << (config.Steps ? contacts / config.Steps : 0) << ",\n";
+        if (config.OdeAllocator)
+        {
+            int steps = std::max(config.Steps, 1);
+            Summary peak = Summarize(peak_bytes);
+            std::cout << "  \"ode_allocator\": { "
+                      << "\"allocs_per_step\": " << (alloc_end.Allocs - alloc_start.Allocs) / steps
+                      << ", \"reallocs_per_step\": " << (alloc_end.Reallocs - alloc_start.Reallocs) / steps
+                      << ", \"system_allocs\": " << alloc_end.SystemAllocs - alloc_start.SystemAllocs
+                      << ", \"system_bytes\": " << alloc_end.SystemBytes - alloc_start.SystemBytes
+                      << ", \"step_peak_bytes\": { \"mean\": " << peak.Mean << ", \"p50\": " << peak.P50
+                      << ", \"p99\": " << peak.P99 << ", \"max\": " << peak.Max << " } },\n";
+        }
+        std::cout << "  \"step_reserve_minimum\": " << reserve_minimum << ",\n";
+        if (config.StepMemory.Instrument)
+        {
+            // Steps are counted from the first measured one
+            std::cout << "  \"step_memory\": { \"arena_allocations\": " << step_memory.Allocations
+                      << ", \"largest_arena\": " << step_memory.LargestArena << ", \"reallocation_steps\": [";
+            for(size_t i = 0; i < step_memory.AllocationSteps.size(); ++i)
+                std::cout << (i ? ", " : "") << step_memory.AllocationSteps[i] - first_step;
+            std::cout << "], \"arena_bytes\": [";
+            for(size_t i = 0; i < arena_bytes.size(); ++i)
+                std::cout << (i ? ", " : "") << arena_bytes[i];
+            std::cout << "] },\n";
+        }
+        std::cout << "  \"phases_us\": {\n";
+        for(int p = 0; p <= NUM_STEP_PHASES; ++p)
+        {
+            Summary s = Summarize(samples[p]);
+            std::cout << "    \"" << (p < NUM_STEP_PHASES ? StepPhaseName(p) : "total") << "\": { \"mean\": " << s.Mean
+                      << ", \"p50\": " << s.P50 << ", \"p99\": " << s.P99 << ", \"max\": " << s.Max << " }"
+                      << (p < NUM_STEP_PHASES ? ",\n" : "\n");
+        }
+        std::cout << "  }\n}\n";
+    }
+
+    dCloseODE();
+}
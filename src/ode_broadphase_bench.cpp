@@ -0,0 +1,119 @@
+// Measures how the cost of dSpaceCollide scales with the number of geoms for every broadphase type. The scene is a
+// pile of unit boxes on a ground plane, laid out on a jittered grid so a realistic fraction of them overlap. Each
+// round moves every box a little so the spaces have to update their AABBs, just like after a world step.
+//
+//     ode_broadphase_bench [max_boxes [rounds [max_simple_boxes]]]
+//
+// Prints CSV: broadphase, boxes, pairs per round, milliseconds per dSpaceCollide.
+
+#include "broadphase.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+void CountPair(void* data, dGeomID, dGeomID)
+{
+    ++*static_cast<size_t*>(data);
+}
+
+// Deterministic jitter so every broadphase sees exactly the same scene
+double Jitter(size_t i, unsigned salt)
+{
+    unsigned x = (unsigned)(i * 2654435761u) ^ (salt * 40503u);
+    x ^= x >> 13;
+    x *= 0x5bd1e995;
+    x ^= x >> 15;
+    return (x & 0xffff) / 65535.0 - 0.5;
+}
+
+void Run(BroadphaseType type, size_t num_boxes, int rounds)
+{
+    // Boxes cover a square patch of the XZ plane, 4 layers high. Rounding up puts any remainder into the top layer
+    // instead of a fifth one.
+    size_t per_layer = std::max<size_t>(1, (num_boxes + 3) / 4);
+    size_t side = (size_t)std::ceil(std::sqrt((double)per_layer));
+    dReal spacing = 1.2;
+
+    BroadphaseConfig config;
+    config.Type = type;
+    // The quadtree splits on X and Y, here that is one side of the patch and the height of the layers
+    config.QuadTreeCenter[0] = config.QuadTreeCenter[2] = side * spacing / 2;
+    config.QuadTreeExtents[0] = config.QuadTreeExtents[2] = side * spacing / 2 + 2;
+    config.QuadTreeCenter[1] = 2.5;
+    config.QuadTreeExtents[1] = 5;
+
+    dSpaceID space = CreateSpace(config);
+    dCreatePlane(space, 0, 1, 0, 0);
+
+    std::vector<dGeomID> boxes(num_boxes);
+    for(size_t i = 0; i < num_boxes; ++i)
+        boxes[i] = dCreateBox(space, 1, 1, 1);
+
+    TuneBroadphase(space, config);
+
+    size_t pairs = 0;
+    double seconds = 0;
+    for(int r = 0; r < rounds; ++r)
+    {
+        for(size_t i = 0; i < num_boxes; ++i)
+        {
+            size_t layer = i / per_layer;
+            size_t j = i % per_layer;
+            dGeomSetPosition(boxes[i], (j % side) * spacing + Jitter(i, r),
+                                       0.5 + layer * 1.05 + 0.1 * Jitter(i, r + 1000),
+                                       (j / side) * spacing + Jitter(i, r + 2000));
+        }
+
+        size_t round_pairs = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        dSpaceCollide(space, &round_pairs, &CountPair);
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        pairs += round_pairs;
+    }
+
+    std::cout << BroadphaseName(type) << ", " << num_boxes << ", " << pairs / rounds << ", "
+              << 1000 * seconds / rounds << std::endl;
+
+    dSpaceDestroy(space);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    size_t max_boxes = argc > 1 ? std::strtoul(argv[1], 0, 10) : 100000;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 10;
+    if (rounds < 1)
+    {
+        std::cerr << "The number of rounds has to be at least 1" << std::endl;
+        return 1;
+    }
+
+    // A simple space with 100k boxes means 5 billion AABB tests per round, not something you want to wait for
+    size_t max_simple_boxes = argc > 3 ? std::strtoul(argv[3], 0, 10) : 10000;
+
+    dInitODE2(0);
+
+    std::cout << "broadphase, boxes, pairs, ms" << std::endl;
+
+    static const BroadphaseType TYPES[] = { BROADPHASE_SIMPLE, BROADPHASE_HASH, BROADPHASE_SAP, BROADPHASE_QUADTREE };
+    for(size_t t = 0; t < sizeof(TYPES) / sizeof(TYPES[0]); ++t)
+    {
+        for(size_t n = 1; n <= max_boxes; n *= 10)
+        {
+            if (TYPES[t] == BROADPHASE_SIMPLE && n > max_simple_boxes)
+                break;
+            Run(TYPES[t], n, rounds);
+        }
+    }
+
+    dCloseODE();
+}
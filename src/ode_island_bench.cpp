@@ -0,0 +1,88 @@
+// Measures the speedup of ODE's island-parallel stepping (see EnableIslandThreading) against the number of islands.
+// Every island is a short stack of boxes standing on the ground, far enough from its neighbours to never touch them.
+// Auto disable is switched off so every island keeps the solver busy for the whole run.
+//
+//     ode_island_bench [max_islands [steps [threads [boxes_per_stack]]]]
+//
+// Prints CSV: islands, bodies, threads, milliseconds per step, speedup over a single thread.
+
+#include "island_threading.h"
+#include "simulation.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+
+double Run(size_t num_islands, int boxes_per_stack, unsigned threads, int steps)
+{
+    BroadphaseConfig broadphase;
+    broadphase.Type = BROADPHASE_HASH;
+
+    Simulation sim;
+    CreateWorld(sim, broadphase);
+    AddPlane(sim, 0, 1, 0, 0);
+    dWorldSetAutoDisableFlag(sim.World, 0);
+
+    size_t side = (size_t)std::ceil(std::sqrt((double)num_islands));
+    dReal sides[3] = { 1, 1, 1 };
+    dMatrix3 R;
+    dRSetIdentity(R);
+
+    for(size_t i = 0; i < num_islands; ++i)
+    {
+        for(int j = 0; j < boxes_per_stack; ++j)
+        {
+            dReal pos[3] = { (dReal)(i % side) * 4, (dReal)0.5 + j, (dReal)(i / side) * 4 };
+            AddBox(sim, pos, sides, R);
+        }
+    }
+    TuneSpaces(sim);
+
+    EnableIslandThreading(sim, threads);
+
+    // Let the stacks settle so every step has a full set of contacts
+    for(int i = 0; i < 50; ++i)
+        SimLoop(sim, 0.01);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int i = 0; i < steps; ++i)
+        SimLoop(sim, 0.01);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    CloseODE(sim);
+
+    return 1000 * seconds / steps;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    size_t max_islands = argc > 1 ? std::strtoul(argv[1], 0, 10) : 256;
+    int steps = argc > 2 ? std::atoi(argv[2]) : 200;
+    unsigned threads = argc > 3 ? std::strtoul(argv[3], 0, 10) : std::thread::hardware_concurrency();
+    int boxes_per_stack = argc > 4 ? std::atoi(argv[4]) : 4;
+
+    dInitODE2(0);
+
+    std::cout << "islands, bodies, threads, ms, speedup" << std::endl;
+
+    for(size_t n = 1; n <= max_islands; n *= 2)
+    {
+        double single = Run(n, boxes_per_stack, 1, steps);
+        std::cout << n << ", " << n * boxes_per_stack << ", 1, " << single << ", 1" << std::endl;
+
+        for(unsigned t = 2; t <= threads; t *= 2)
+        {
+            double ms = Run(n, boxes_per_stack, t, steps);
+            std::cout << n << ", " << n * boxes_per_stack << ", " << t << ", " << ms << ", " << single / ms << std::endl;
+        }
+    }
+
+    dCloseODE();
+}
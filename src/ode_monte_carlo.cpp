@@ -0,0 +1,122 @@
+// Drops the example box many times with randomized initial conditions on all cores and writes aggregated statistics
+// (see monte_carlo.h).
+//
+//     ode_monte_carlo [--samples N] [--threads N] [--run-id N] [--time-step DT] [--max-steps N]
+//                     [--angle DIST] [--height DIST] [--vx DIST] [--vy DIST] [--vz DIST] [--density DIST]
+//                     [--position-bins N] [--position-range R] [--rest-time-bins N] [--block-size N]
+//                     [--output stats.json]
+//
+// DIST is fixed:a, uniform:lo:hi or normal:mean:stddev. Every density drawn has to be positive, so a normal density
+// is refused. The statistics file is rewritten after every round of blocks while the run progresses.
+
+#include "monte_carlo.h"
+#include "simulation.h"
+#include "thread_pool.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+bool ParseArgs(int argc, char** argv, MonteCarloConfig& config, unsigned& threads, std::string& output)
+{
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+
+        Distribution* distribution = 0;
+        if (arg == "--samples")
+            config.Samples = std::strtoull(value.c_str(), 0, 10);
+        else if (arg == "--threads")
+            threads = std::strtoul(value.c_str(), 0, 10);
+        else if (arg == "--run-id")
+            config.RunId = std::strtoull(value.c_str(), 0, 10);
+        else if (arg == "--time-step")
+            config.TimeStep = std::atof(value.c_str());
+        else if (arg == "--max-steps")
+            config.MaxSteps = std::strtoull(value.c_str(), 0, 10);
+        else if (arg == "--position-bins")
+            config.PositionBins = std::strtoul(value.c_str(), 0, 10);
+        else if (arg == "--position-range")
+            config.PositionRange = std::atof(value.c_str());
+        else if (arg == "--rest-time-bins")
+            config.RestTimeBins = std::strtoul(value.c_str(), 0, 10);
+        else if (arg == "--block-size")
+            config.BlockSize = std::strtoull(value.c_str(), 0, 10);
+        else if (arg == "--output")
+            output = value;
+        else if (arg == "--angle")
+            distribution = &config.Angle;
+        else if (arg == "--height")
+            distribution = &config.Height;
+        else if (arg == "--vx")
+            distribution = &config.VelocityX;
+        else if (arg == "--vy")
+            distribution = &config.VelocityY;
+        else if (arg == "--vz")
+            distribution = &config.VelocityZ;
+        else if (arg == "--density")
+            distribution = &config.Density;
+        else
+        {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return false;
+        }
+
+        if (distribution && !Distribution::Parse(value, *distribution))
+        {
+            std::cerr << "Invalid distribution '" << value << "' for " << arg << std::endl;
+            return false;
+        }
+    }
+    if (const char* error = MonteCarloConfigError(config))
+    {
+        std::cerr << "Invalid options: " << error << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    MonteCarloConfig config;
+    unsigned threads = 0;
+    std::string output = "monte_carlo.json";
+    if (!ParseArgs(argc, argv, config, threads, output))
+        return 1;
+
+    dInitODE2(0);
+
+    bool ok;
+    MonteCarloStats stats;
+    double seconds;
+    {
+        ThreadPool pool(threads);
+        std::cout << "Running " << config.Samples << " samples on " << pool.NumThreads() << " threads" << std::endl;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        ok = RunMonteCarlo(config, pool, output, stats);
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    dCloseODE();
+
+    std::cout << stats.Samples << " samples in " << seconds << " s (" << stats.Samples / seconds << " samples/s), "
+              << stats.Settled << " settled, mean time to rest " << stats.RestTimeMean << " s, "
+              << (stats.Samples ? (double)stats.Contacts / stats.Samples : 0.0) << " contacts per sample" << std::endl;
+    std::cout << "Statistics written to " << output << std::endl;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+// Scene file utility (see scene.h).
+//
+//     ode_scene_tool convert <in> <out>        converts between text and binary, .scene means text
+//     ode_scene_tool pile <num_bodies> <out>   writes a pile of boxes like the one ode_bench uses
+//     ode_scene_tool load <file> [snapshot]    loads and builds a scene (and restores a snapshot of it) and reports
+//                                              how long that took
+//     ode_scene_tool settle <file> <max_steps> <snapshot>
+//                                              simulates the scene until it is at rest and saves a snapshot of it
+
+#include "scene.h"
+#include "simulation.h"
+#include "snapshot.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+bool IsTextScene(const std::string& path)
+{
+    const std::string ext = ".scene";
+    return path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+bool SaveScene(const std::string& path, const Scene& scene)
+{
+    return IsTextScene(path) ? SaveSceneText(path, scene) : SaveSceneBinary(path, scene);
+}
+
+double Seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void MakePile(Scene& scene, size_t num_bodies)
+{
+    scene.World.Broadphase = BROADPHASE_HASH;
+
+    SceneGeom ground = SceneGeom();
+    ground.Shape = SHAPE_PLANE;
+    ground.Size[1] = 1;
+    scene.Static.push_back(ground);
+
+    size_t columns = num_bodies / 8 > 1 ? (size_t)std::sqrt((double)num_bodies / 8) : 1;
+    scene.Bodies.resize(num_bodies, SceneBody());
+    for(size_t i = 0; i < num_bodies; ++i)
+    {
+        SceneBody& b = scene.Bodies[i];
+        size_t column = i % (columns * columns);
+        size_t layer = i / (columns * columns);
+
+        b.Shape = SHAPE_BOX;
+        b.Size[0] = b.Size[1] = b.Size[2] = 1;
+        b.Position[0] = (dReal)(column % columns) * 1.5;
+        b.Position[1] = 1 + (dReal)layer * 1.8;
+        b.Position[2] = (dReal)(column / columns) * 1.5;
+        b.Quaternion[0] = 1;
+    }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::string command = argc > 1 ? argv[1] : "";
+
+    if (command == "convert" && argc == 4)
+    {
+        Scene scene;
+        return LoadScene(argv[2], scene) && SaveScene(argv[3], scene) ? 0 : 1;
+    }
+
+    if (command == "pile" && argc == 4)
+    {
+        Scene scene;
+        MakePile(scene, std::strtoul(argv[2], 0, 10));
+        return SaveScene(argv[3], scene) ? 0 : 1;
+    }
+
+    if (command == "load" && (argc == 3 || argc == 4))
+    {
+        dInitODE2(0);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Scene scene;
+        if (!LoadScene(argv[2], scene))
+        {
+            dCloseODE();
+            return 1;
+        }
+        double load_time = Seconds(start);
+
+        start = std::chrono::steady_clock::now();
+        Simulation sim;
+        BuildScene(sim, scene);
+        double build_time = Seconds(start);
+
+        std::cout << scene.Bodies.size() << " bodies, " << scene.Static.size() << " static geoms, "
+                  << scene.Materials.size() << " materials: load " << load_time * 1000 << " ms, build "
+                  << build_time * 1000 << " ms";
+
+        if (argc == 4)
+        {
+            start = std::chrono::steady_clock::now();
+            bool restored = LoadSnapshot(argv[3], sim);
+            std::cout << ", restore " << Seconds(start) * 1000 << " ms" << (restored ? "" : " (failed)");
+        }
+        std::cout << "\n";
+
+        CloseODE(sim);
+        dCloseODE();
+        return 0;
+    }
+
+    if (command == "settle" && argc == 5)
+    {
+        dInitODE2(0);
+
+        Scene scene;
+        if (!LoadScene(argv[2], scene))
+        {
+            dCloseODE();
+            return 1;
+        }
+
+        Simulation sim;
+        BuildScene(sim, scene);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        RunSteps(sim, 0.01, std::strtoull(argv[3], 0, 10), REST_STOP);
+        std::cout << sim.StepCount << " steps in " << Seconds(start) << " s, "
+                  << (AtRest(sim) ? "at rest" : "not at rest yet") << "\n";
+
+        bool ok = SaveSnapshot(argv[4], sim);
+        CloseODE(sim);
+        dCloseODE();
+        return ok ? 0 : 1;
+    }
+
+    std::cerr << "Usage: " << argv[0] << " convert <in> <out> | pile <num_bodies> <out> | load <file> [snapshot] | "
+              << "settle <file> <max_steps> <snapshot>" << std::endl;
+    return 1;
+}
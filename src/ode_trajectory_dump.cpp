@@ -0,0 +1,58 @@
+// Prints the contents of a trajectory file written by TrajectoryWriter as text.
+//
+//     ode_trajectory_dump trajectory_file [first_step [num_frames]]
+
+#include "trajectory.h"
+
+#include <cstdlib>
+#include <iostream>
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " trajectory_file [first_step [num_frames]]" << std::endl;
+        return 1;
+    }
+
+    TrajectoryReader reader;
+    if (!reader.Open(argv[1]))
+        return 1;
+
+    uint64_t first_step = argc > 2 ? std::strtoull(argv[2], 0, 10) : 0;
+    uint64_t num_frames = argc > 3 ? std::strtoull(argv[3], 0, 10) : reader.NumFrames();
+
+    unsigned fields = reader.Fields();
+
+    std::cout << "step, body";
+    if (fields & TRAJ_POSITION)
+        std::cout << ", x, y, z";
+    if (fields & TRAJ_QUATERNION)
+        std::cout << ", qw, qx, qy, qz";
+    if (fields & TRAJ_LINEAR_VEL)
+        std::cout << ", vx, vy, vz";
+    if (fields & TRAJ_ANGULAR_VEL)
+        std::cout << ", wx, wy, wz";
+    std::cout << "\n";
+
+    TrajectorySample s;
+    for(uint64_t frame = reader.FindStep(first_step); frame < reader.NumFrames() && num_frames > 0; ++frame, --num_frames)
+    {
+        for(unsigned body = 0; body < reader.NumBodies(); ++body)
+        {
+            reader.Read(frame, body, s);
+
+            std::cout << s.Step << ", " << s.Body;
+            if (fields & TRAJ_POSITION)
+                std::cout << ", " << s.Position[0] << ", " << s.Position[1] << ", " << s.Position[2];
+            if (fields & TRAJ_QUATERNION)
+                std::cout << ", " << s.Quaternion[0] << ", " << s.Quaternion[1] << ", " << s.Quaternion[2]
+                          << ", " << s.Quaternion[3];
+            if (fields & TRAJ_LINEAR_VEL)
+                std::cout << ", " << s.LinearVel[0] << ", " << s.LinearVel[1] << ", " << s.LinearVel[2];
+            if (fields & TRAJ_ANGULAR_VEL)
+                std::cout << ", " << s.AngularVel[0] << ", " << s.AngularVel[1] << ", " << s.AngularVel[2];
+            std::cout << "\n";
+        }
+    }
+}
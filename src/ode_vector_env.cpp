@@ -0,0 +1,58 @@
+// Drives a VectorEnv with random actions and reports the throughput, as a stand-in for a learning loop.
+//
+//     ode_vector_env [num_worlds] [num_threads] [num_steps]
+
+#include "vector_env.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+    VectorEnvConfig config;
+    config.NumWorlds = argc > 1 ? std::strtoul(argv[1], 0, 10) : 1024;
+    config.NumThreads = argc > 2 ? std::strtoul(argv[2], 0, 10) : 0;
+    int num_steps = argc > 3 ? std::atoi(argv[3]) : 1000;
+
+    dInitODE2(0);
+
+    {
+        VectorEnv env(config);
+        env.Reset();
+
+        std::vector<float> actions(env.NumWorlds() * VectorEnv::ACTION_SIZE);
+        uint32_t seed = 1;
+
+        uint64_t episodes = 0;
+        double reward = 0;
+        double seconds = 0;
+
+        for(int step = 0; step < num_steps; ++step)
+        {
+            // A learner would compute these from env.Observations()
+            for(size_t i = 0; i < actions.size(); ++i)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                actions[i] = (float)(seed >> 8) / (float)(1 << 24) * 2 - 1;
+            }
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            env.Step(&actions[0]);
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            for(size_t i = 0; i < env.NumWorlds(); ++i)
+            {
+                reward += env.Rewards()[i];
+                episodes += env.Dones()[i];
+            }
+        }
+
+        std::cout << env.NumWorlds() << " worlds, " << env.Pool().NumThreads() << " threads, " << num_steps
+                  << " steps: " << seconds << " s (" << (env.NumWorlds() * num_steps) / seconds << " env steps / s), "
+                  << episodes << " episodes, mean reward " << reward / (env.NumWorlds() * num_steps) << "\n";
+    }
+
+    dCloseODE();
+}
@@ -0,0 +1,66 @@
+// Compares the cost of starting an episode by building a new world (InitODE ... CloseODE) with taking one from a
+// WorldPool and resetting it in place.
+//
+//     ode_world_pool [episodes] [steps_per_episode]
+
+#include "world_pool.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+double Seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    int episodes = argc > 1 ? std::atoi(argv[1]) : 10000;
+    int steps = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    dInitODE2(0);
+
+    // Only the time outside of RunSteps is turnover
+    double rebuild = 0;
+    for(int e = 0; e < episodes; ++e)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Simulation sim;
+        InitODE(sim);
+        rebuild += Seconds(start);
+
+        RunSteps(sim, 0.01, steps);
+
+        start = std::chrono::steady_clock::now();
+        CloseODE(sim);
+        rebuild += Seconds(start);
+    }
+
+    double pooled = 0;
+    {
+        WorldPool pool(1);
+        for(int e = 0; e < episodes; ++e)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            Simulation* sim = pool.Acquire();
+            pooled += Seconds(start);
+
+            RunSteps(*sim, 0.01, steps);
+
+            start = std::chrono::steady_clock::now();
+            pool.Release(sim);
+            pooled += Seconds(start);
+        }
+    }
+
+    std::cout << episodes << " episodes of " << steps << " steps, turnover per episode: rebuild "
+              << rebuild / episodes * 1e6 << " us, pool " << pooled / episodes * 1e6 << " us\n";
+
+    dCloseODE();
+}
@@ -0,0 +1,265 @@
+#include "output.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+#ifdef ODE_EXAMPLE_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace
+{
+
+size_t RoundUpToPowerOfTwo(size_t n)
+{
+    size_t p = 1;
+    while (p < n)
+        p <<= 1;
+    return p;
+}
+
+void FormatSample(std::string& line, const TrajectorySample& s)
+{
+    char buffer[512];
+    int n = std::snprintf(buffer, sizeof(buffer),
+                          "%llu, %u, %.9g, %.9g, %.9g, %.9g, %.9g, %.9g, %.9g, %.9g, %.9g, %.9g, %.9g, %.9g, %.9g\n",
+                          (unsigned long long)s.Step, s.Body,
+                          s.Position[0], s.Position[1], s.Position[2],
+                          s.Quaternion[0], s.Quaternion[1], s.Quaternion[2], s.Quaternion[3],
+                          s.LinearVel[0], s.LinearVel[1], s.LinearVel[2],
+                          s.AngularVel[0], s.AngularVel[1], s.AngularVel[2]);
+    line.append(buffer, n);
+}
+
+const char CSV_HEADER[] = "step, body, x, y, z, qw, qx, qy, qz, vx, vy, vz, wx, wy, wz\n";
+
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+CsvSink::CsvSink(const std::string& path) : out_(path.c_str())
+{
+    if (out_.is_open())
+        out_ << CSV_HEADER;
+    else
+        std::cerr << "[CsvSink] Could not open '" << path << "'" << std::endl;
+}
+
+bool CsvSink::Write(const BodySnapshot& snapshot)
+{
+    std::string lines;
+    for(size_t i = 0; i < snapshot.Bodies.size(); ++i)
+        FormatSample(lines, snapshot.Bodies[i]);
+
+    out_.write(lines.data(), lines.size());
+    return out_.good();
+}
+
+void CsvSink::Flush()
+{
+    out_.flush();
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+BinarySink::BinarySink(const std::string& path, unsigned fields, unsigned num_bodies)
+{
+    writer_.Open(path, fields, num_bodies);
+}
+
+bool BinarySink::Write(const BodySnapshot& snapshot)
+{
+    return writer_.Record(snapshot.Bodies.data(), snapshot.Bodies.size());
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+#ifdef ODE_EXAMPLE_HAVE_ZLIB
+
+GzipCsvSink::GzipCsvSink(const std::string& path) : file_(gzopen(path.c_str(), "wb"))
+{
+    if (file_)
+        gzputs(static_cast<gzFile>(file_), CSV_HEADER);
+    else
+        std::cerr << "[GzipCsvSink] Could not open '" << path << "'" << std::endl;
+}
+
+GzipCsvSink::~GzipCsvSink()
+{
+    if (file_)
+        gzclose(static_cast<gzFile>(file_));
+}
+
+bool GzipCsvSink::Write(const BodySnapshot& snapshot)
+{
+    if (!file_)
+        return false;
+
+    line_.clear();
+    for(size_t i = 0; i < snapshot.Bodies.size(); ++i)
+        FormatSample(line_, snapshot.Bodies[i]);
+
+    return gzwrite(static_cast<gzFile>(file_), line_.data(), line_.size()) == (int)line_.size();
+}
+
+void GzipCsvSink::Flush()
+{
+    if (file_)
+        gzflush(static_cast<gzFile>(file_), Z_SYNC_FLUSH);
+}
+
+#endif
+
+// ----------------------------------------------------------------------------------------------------
+
+OutputPipeline::OutputPipeline(OutputSink& sink, unsigned num_bodies, const OutputConfig& config)
+    : sink_(sink), config_(config), head_(0), tail_(0), offered_(0), running_(false), pushed_(0), written_(0),
+      dropped_(0), downsampled_(0), wrong_body_count_(0), backpressure_waits_(0), backpressure_nanos_(0), sink_errors_(0)
+{
+    // All snapshot memory is allocated here, pushing never allocates
+    slots_.resize(RoundUpToPowerOfTwo(config_.Capacity < 2 ? 2 : config_.Capacity));
+    mask_ = slots_.size() - 1;
+
+    for(size_t i = 0; i < slots_.size(); ++i)
+        slots_[i].Bodies.resize(num_bodies);
+
+    if (config_.DownsampleFactor == 0)
+        config_.DownsampleFactor = 1;
+}
+
+OutputPipeline::~OutputPipeline()
+{
+    Stop();
+}
+
+void OutputPipeline::Start()
+{
+    if (running_.exchange(true))
+        return;
+
+    writer_ = std::thread(&OutputPipeline::WriterMain, this);
+}
+
+void OutputPipeline::Stop()
+{
+    if (!running_.exchange(false))
+        return;
+
+    writer_.join();
+
+    // Whatever was pushed after the writer saw running_ go false
+    Drain();
+    sink_.Flush();
+}
+
+bool OutputPipeline::Push(uint64_t step, const Simulation& sim)
+{
+    // Every slot has room for exactly num_bodies, a world with more or fewer bodies would write partial snapshots
+    if (sim.Objects.size() != slots_[0].Bodies.size())
+    {
+        wrong_body_count_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    uint64_t used = tail - head_.load(std::memory_order_acquire);
+
+    if (config_.Policy == OUTPUT_DOWNSAMPLE && used >= config_.DownsampleThreshold * slots_.size())
+    {
+        if (offered_++ % config_.DownsampleFactor != 0)
+        {
+            downsampled_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+    else
+        offered_ = 0;
+
+    if (used >= slots_.size())
+    {
+        if (config_.Policy != OUTPUT_BACKPRESSURE || !running_.load(std::memory_order_relaxed))
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        while (tail - head_.load(std::memory_order_acquire) >= slots_.size())
+            std::this_thread::yield();
+
+        backpressure_waits_.fetch_add(1, std::memory_order_relaxed);
+        backpressure_nanos_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now() - start).count(),
+                                      std::memory_order_relaxed);
+    }
+
+    BodySnapshot& snapshot = slots_[tail & mask_];
+    snapshot.Step = step;
+
+    for(size_t i = 0; i < snapshot.Bodies.size(); ++i)
+    {
+        dBodyID body = sim.Objects[i].Body;
+        const dReal* p = dBodyGetPosition(body);
+        const dReal* q = dBodyGetQuaternion(body);
+        const dReal* v = dBodyGetLinearVel(body);
+        const dReal* w = dBodyGetAngularVel(body);
+
+        TrajectorySample& s = snapshot.Bodies[i];
+        s.Step = step;
+        s.Body = (uint32_t)i;
+        for(int j = 0; j < 3; ++j)
+        {
+            s.Position[j] = p[j];
+            s.LinearVel[j] = v[j];
+            s.AngularVel[j] = w[j];
+        }
+        for(int j = 0; j < 4; ++j)
+            s.Quaternion[j] = q[j];
+    }
+
+    tail_.store(tail + 1, std::memory_order_release);
+    pushed_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+size_t OutputPipeline::Drain()
+{
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+
+    for(uint64_t i = head; i != tail; ++i)
+    {
+        if (!sink_.Write(slots_[i & mask_]))
+            sink_errors_.fetch_add(1, std::memory_order_relaxed);
+
+        // Hand the slot back right away so a producer under backpressure can continue
+        head_.store(i + 1, std::memory_order_release);
+        written_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return tail - head;
+}
+
+void OutputPipeline::WriterMain()
+{
+    while (running_.load(std::memory_order_acquire))
+    {
+        if (Drain() == 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+OutputStats OutputPipeline::Stats() const
+{
+    OutputStats stats;
+    stats.Pushed = pushed_.load(std::memory_order_relaxed);
+    stats.Written = written_.load(std::memory_order_relaxed);
+    stats.Dropped = dropped_.load(std::memory_order_relaxed);
+    stats.Downsampled = downsampled_.load(std::memory_order_relaxed);
+    stats.WrongBodyCount = wrong_body_count_.load(std::memory_order_relaxed);
+    stats.BackpressureWaits = backpressure_waits_.load(std::memory_order_relaxed);
+    stats.BackpressureNanos = backpressure_nanos_.load(std::memory_order_relaxed);
+    stats.SinkErrors = sink_errors_.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,157 @@
+#ifndef ODE_EXAMPLE_OUTPUT_H
+#define ODE_EXAMPLE_OUTPUT_H
+
+#include "simulation.h"
+#include "trajectory.h"
+
+#include <atomic>
+#include <cstddef>
+#include <fstream>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Output stage that takes the writing of body states off the physics thread. SimLoop copies the state of all bodies
+// into a slot of a lock-free single-producer / single-consumer ring and returns, a background thread drains the ring
+// into an OutputSink. The physics thread never touches a file.
+
+// The state of all bodies of a world after one step
+struct BodySnapshot
+{
+    uint64_t Step;
+    std::vector<TrajectorySample> Bodies;
+};
+
+// Destination for snapshots. Only ever called from the writer thread.
+class OutputSink
+{
+public:
+    virtual ~OutputSink() {}
+    virtual bool IsOpen() const = 0;  // false if the destination could not be opened, every Write would fail
+    virtual bool Write(const BodySnapshot& snapshot) = 0;
+    virtual void Flush() {}
+};
+
+// Text output, one line per body per step
+class CsvSink : public OutputSink
+{
+public:
+    explicit CsvSink(const std::string& path);
+    bool IsOpen() const { return out_.is_open(); }
+    bool Write(const BodySnapshot& snapshot);
+    void Flush();
+
+private:
+    std::ofstream out_;
+};
+
+// Binary trajectory file, see TrajectoryWriter
+class BinarySink : public OutputSink
+{
+public:
+    BinarySink(const std::string& path, unsigned fields, unsigned num_bodies);
+    bool IsOpen() const { return writer_.IsOpen(); }
+    bool Write(const BodySnapshot& snapshot);
+
+private:
+    TrajectoryWriter writer_;
+};
+
+#ifdef ODE_EXAMPLE_HAVE_ZLIB
+// Same text as CsvSink but gzip compressed
+class GzipCsvSink : public OutputSink
+{
+public:
+    explicit GzipCsvSink(const std::string& path);
+    ~GzipCsvSink();
+    bool IsOpen() const { return file_ != 0; }
+    bool Write(const BodySnapshot& snapshot);
+    void Flush();
+
+private:
+    void* file_;  // gzFile
+    std::string line_;
+};
+#endif
+
+// What Push does when the writer thread falls behind
+enum OutputPolicy
+{
+    OUTPUT_DROP,          // discard the snapshot if the ring is full
+    OUTPUT_DOWNSAMPLE,    // once the ring is filling up only keep every DownsampleFactor-th snapshot, drop if full
+    OUTPUT_BACKPRESSURE   // wait for the writer to free a slot
+};
+
+struct OutputConfig
+{
+    size_t Capacity;             // number of snapshot slots, rounded up to a power of two
+    OutputPolicy Policy;
+    unsigned DownsampleFactor;   // OUTPUT_DOWNSAMPLE: keep one out of this many snapshots while behind
+    double DownsampleThreshold;  // OUTPUT_DOWNSAMPLE: ring fill fraction at which downsampling starts
+
+    OutputConfig() : Capacity(1024), Policy(OUTPUT_DROP), DownsampleFactor(4), DownsampleThreshold(0.75) {}
+};
+
+// Counters are updated with relaxed atomics and can be read from any thread at any time
+struct OutputStats
+{
+    uint64_t Pushed;             // snapshots that made it into the ring
+    uint64_t Written;            // snapshots handed to the sink
+    uint64_t Dropped;            // discarded because the ring was full
+    uint64_t Downsampled;        // skipped by OUTPUT_DOWNSAMPLE
+    uint64_t WrongBodyCount;     // refused because the world did not have the pipeline's number of bodies
+    uint64_t BackpressureWaits;  // pushes that had to wait for a free slot
+    uint64_t BackpressureNanos;  // total time spent waiting
+    uint64_t SinkErrors;         // writes the sink reported as failed
+};
+
+class OutputPipeline
+{
+public:
+    OutputPipeline(OutputSink& sink, unsigned num_bodies, const OutputConfig& config = OutputConfig());
+    ~OutputPipeline();
+
+    // Starts / stops the writer thread. Stop drains everything that is still in the ring before returning.
+    void Start();
+    void Stop();
+
+    // Called on the physics thread. Copies the state of all bodies of sim into the ring. Returns false if the
+    // snapshot was dropped or downsampled away, or if sim does not have the number of bodies the pipeline was created
+    // for.
+    bool Push(uint64_t step, const Simulation& sim);
+
+    OutputStats Stats() const;
+
+private:
+    OutputPipeline(const OutputPipeline&);
+    OutputPipeline& operator=(const OutputPipeline&);
+
+    void WriterMain();
+    size_t Drain();
+
+    OutputSink& sink_;
+    OutputConfig config_;
+
+    std::vector<BodySnapshot> slots_;
+    size_t mask_;
+
+    // Producer and consumer indices live on their own cache lines so the two threads do not fight over them
+    alignas(64) std::atomic<uint64_t> head_;  // next slot to be read, written by the writer thread
+    alignas(64) std::atomic<uint64_t> tail_;  // next slot to be filled, written by the physics thread
+    alignas(64) uint64_t offered_;            // physics thread only, counts pushes for downsampling
+
+    std::atomic<bool> running_;
+    std::thread writer_;
+
+    std::atomic<uint64_t> pushed_;
+    std::atomic<uint64_t> written_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> downsampled_;
+    std::atomic<uint64_t> wrong_body_count_;
+    std::atomic<uint64_t> backpressure_waits_;
+    std::atomic<uint64_t> backpressure_nanos_;
+    std::atomic<uint64_t> sink_errors_;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef ODE_EXAMPLE_PROFILE_H
+#define ODE_EXAMPLE_PROFILE_H
+
+#include <chrono>
+#include <stdint.h>
+
+// Per-phase timing of a single SimLoop call. SimLoop fills in the profile pointed to by Simulation::Profile, when
+// that pointer is null no clocks are read at all.
+enum StepPhase
+{
+    PHASE_BROADPHASE,   // dSpaceCollide / dSpaceCollide2 without the time spent in the near callback
+    PHASE_NARROWPHASE,  // dCollide
+    PHASE_CONTACTS,     // dJointCreateContact and dJointAttach
+    PHASE_STEP,         // dWorldQuickStep
+    PHASE_EMPTY,        // dJointGroupEmpty
+
+    NUM_STEP_PHASES
+};
+
+inline const char* StepPhaseName(int phase)
+{
+    static const char* NAMES[NUM_STEP_PHASES] = { "broadphase", "narrowphase", "contacts", "step", "empty" };
+    return phase >= 0 && phase < NUM_STEP_PHASES ? NAMES[phase] : "unknown";
+}
+
+struct StepProfile
+{
+    double Seconds[NUM_STEP_PHASES];
+    uint64_t Pairs;     // candidate pairs handed to the narrowphase
+    uint64_t Contacts;  // contact joints created
+
+    StepProfile() { Reset(); }
+
+    void Reset()
+    {
+        for(int i = 0; i < NUM_STEP_PHASES; ++i)
+            Seconds[i] = 0;
+        Pairs = 0;
+        Contacts = 0;
+    }
+
+    double Total() const
+    {
+        double total = 0;
+        for(int i = 0; i < NUM_STEP_PHASES; ++i)
+            total += Seconds[i];
+        return total;
+    }
+};
+
+inline double ProfileClock()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif
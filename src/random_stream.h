@@ -0,0 +1,97 @@
+#ifndef ODE_EXAMPLE_RANDOM_STREAM_H
+#define ODE_EXAMPLE_RANDOM_STREAM_H
+
+#include <stdint.h>
+
+// Counter based random numbers (Philox4x32-10, Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3"). The
+// n-th number of a stream is a pure function of (run id, stream id, n), there is no shared state to contend on and
+// nothing depends on which thread draws from which stream. Giving every world its own stream, keyed by the run id
+// and the world index, makes a batch of worlds bit-reproducible however the worlds are spread over threads.
+//
+// ODE's dRandReal, which InitODE used before, has a single global state: worlds built in parallel would race on it,
+// and the numbers a world got depended on the order in which the worlds were built.
+class RandomStream
+{
+public:
+    explicit RandomStream(uint64_t run_id = 0, uint64_t stream = 0)
+        : index_(4)
+    {
+        key_[0] = (uint32_t)run_id;
+        key_[1] = (uint32_t)(run_id >> 32);
+        counter_[0] = 0;
+        counter_[1] = 0;
+        counter_[2] = (uint32_t)stream;
+        counter_[3] = (uint32_t)(stream >> 32);
+    }
+
+    uint32_t NextU32()
+    {
+        if (index_ == 4)
+        {
+            Generate();
+            index_ = 0;
+        }
+        return block_[index_++];
+    }
+
+    // Uniform in [0, 1) with 53 random bits
+    double NextReal()
+    {
+        uint32_t a = NextU32() >> 5;
+        uint32_t b = NextU32() >> 6;
+        return (a * 67108864.0 + b) * (1.0 / 9007199254740992.0);
+    }
+
+    // Uniform in [lo, hi)
+    double Uniform(double lo, double hi) { return lo + (hi - lo) * NextReal(); }
+
+    // The bare Philox4x32-10 block function: encrypts 'counter' with 'key'
+    static void Philox(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4])
+    {
+        uint32_t c[4] = { counter[0], counter[1], counter[2], counter[3] };
+        uint32_t k[2] = { key[0], key[1] };
+
+        for(int round = 0; round < 10; ++round)
+        {
+            uint32_t hi0, lo0, hi1, lo1;
+            MulHiLo(0xD2511F53u, c[0], hi0, lo0);
+            MulHiLo(0xCD9E8D57u, c[2], hi1, lo1);
+
+            uint32_t next[4] = { hi1 ^ c[1] ^ k[0], lo1, hi0 ^ c[3] ^ k[1], lo0 };
+            c[0] = next[0];
+            c[1] = next[1];
+            c[2] = next[2];
+            c[3] = next[3];
+
+            k[0] += 0x9E3779B9u;
+            k[1] += 0xBB67AE85u;
+        }
+
+        for(int i = 0; i < 4; ++i)
+            out[i] = c[i];
+    }
+
+private:
+    static void MulHiLo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo)
+    {
+        uint64_t product = (uint64_t)a * b;
+        hi = (uint32_t)(product >> 32);
+        lo = (uint32_t)product;
+    }
+
+    // Encrypts the counter into the next four numbers and advances the 64 bit counter
+    void Generate()
+    {
+        Philox(counter_, key_, block_);
+
+        if (++counter_[0] == 0)
+            ++counter_[1];
+    }
+
+    uint32_t key_[2];
+    uint32_t counter_[4];  // 0, 1: position in the stream, 2, 3: stream id
+    uint32_t block_[4];
+    int index_;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "rewind.h"
+
+#include <cstring>
+
+void CaptureWorldState(const Simulation& sim, WorldState& state)
+{
+    size_t n = sim.Objects.size();
+
+    // resize() does nothing if the size is unchanged, which it is in steady state
+    state.Position.resize(3 * n);
+    state.Quaternion.resize(4 * n);
+    state.LinearVel.resize(3 * n);
+    state.AngularVel.resize(3 * n);
+    state.Enabled.resize(n);
+
+    for(size_t i = 0; i < n; ++i)
+    {
+        dBodyID body = sim.Objects[i].Body;
+        std::memcpy(&state.Position[3 * i], dBodyGetPosition(body), 3 * sizeof(dReal));
+        std::memcpy(&state.Quaternion[4 * i], dBodyGetQuaternion(body), 4 * sizeof(dReal));
+        std::memcpy(&state.LinearVel[3 * i], dBodyGetLinearVel(body), 3 * sizeof(dReal));
+        std::memcpy(&state.AngularVel[3 * i], dBodyGetAngularVel(body), 3 * sizeof(dReal));
+        state.Enabled[i] = dBodyIsEnabled(body) ? 1 : 0;
+    }
+
+    state.Step = sim.StepCount;
+    state.RestStep = sim.RestStep;
+}
+
+void RestoreWorldState(Simulation& sim, const WorldState& state)
+{
+    for(size_t i = 0; i < sim.Objects.size(); ++i)
+    {
+        dBodyID body = sim.Objects[i].Body;
+        const dReal* p = &state.Position[3 * i];
+        const dReal* v = &state.LinearVel[3 * i];
+        const dReal* w = &state.AngularVel[3 * i];
+
+        dBodySetPosition(body, p[0], p[1], p[2]);
+        dBodySetQuaternion(body, &state.Quaternion[4 * i]);
+        dBodySetLinearVel(body, v[0], v[1], v[2]);
+        dBodySetAngularVel(body, w[0], w[1], w[2]);
+
+        if (state.Enabled[i])
+            dBodyEnable(body);
+        else
+            dBodyDisable(body);
+    }
+
+    sim.StepCount = state.Step;
+    sim.RestStep = state.RestStep;
+
+    // Flights in progress were computed from the state that is being thrown away
+    CancelBallisticFlights(sim);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+RewindBuffer::RewindBuffer(size_t capacity, unsigned interval)
+    : slots_(capacity ? capacity : 1), interval_(interval ? interval : 1), head_(0), count_(0)
+{
+}
+
+void RewindBuffer::Capture(const Simulation& sim)
+{
+    if (sim.StepCount % interval_ != 0)
+        return;
+
+    // Overwrite the oldest state once the ring is full
+    size_t slot;
+    if (count_ < slots_.size())
+        slot = Slot(count_++);
+    else
+    {
+        slot = head_;
+        head_ = Slot(1);
+    }
+
+    CaptureWorldState(sim, slots_[slot]);
+}
+
+bool RewindBuffer::Rewind(Simulation& sim, uint64_t step)
+{
+    // States are in step order, search from the newest one
+    size_t i = count_;
+    while (i > 0 && slots_[Slot(i - 1)].Step > step)
+        --i;
+
+    if (i == 0)
+        return false;
+
+    RestoreWorldState(sim, slots_[Slot(i - 1)]);
+
+    // The restored state stays in the ring, everything after it is about to be simulated again
+    count_ = i;
+    return true;
+}
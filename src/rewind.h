@@ -0,0 +1,70 @@
+#ifndef ODE_EXAMPLE_REWIND_H
+#define ODE_EXAMPLE_REWIND_H
+
+#include "simulation.h"
+
+#include <stdint.h>
+#include <vector>
+
+// The state of every body in sim.Objects at one step, as one flat array per quantity (structure of arrays). Body i
+// is at [3 * i] in the vector arrays and at [4 * i] in Quaternion.
+struct WorldState
+{
+    uint64_t Step;  // sim.StepCount when the state was captured
+    uint64_t RestStep;
+    std::vector<dReal> Position;
+    std::vector<dReal> Quaternion;
+    std::vector<dReal> LinearVel;
+    std::vector<dReal> AngularVel;
+    std::vector<uint8_t> Enabled;
+
+    WorldState() : Step(0), RestStep(NOT_AT_REST) {}
+};
+
+// Copies the body states into state. Only allocates if the number of bodies changed since the last capture into the
+// same WorldState.
+void CaptureWorldState(const Simulation& sim, WorldState& state);
+
+// Puts every body back into the captured state, including sim.StepCount and sim.RestStep. The state must have been
+// captured from this world (same bodies in the same order). Like snapshots (see snapshot.h) this cannot bring back
+// ODE's internal auto disable counters, a body that is enabled in the state starts its idle count from zero.
+void RestoreWorldState(Simulation& sim, const WorldState& state);
+
+// Ring of the last few world states for rollback and resimulation, for example when input from an external
+// controller arrives a few steps late: rewind to the step the input belongs to, apply it, and run the steps again.
+//
+// When set as sim.Rewind, SimLoop captures the state after every interval-th step. All slots are allocated on the
+// first capture, after that capturing is a copy of the body states into the oldest slot.
+class RewindBuffer
+{
+public:
+    explicit RewindBuffer(size_t capacity, unsigned interval = 1);
+
+    // Called by SimLoop after every step
+    void Capture(const Simulation& sim);
+
+    // Restores the newest state captured at or before 'step' and drops all states after it. Returns false and leaves
+    // sim alone if no such state is in the ring anymore.
+    bool Rewind(Simulation& sim, uint64_t step);
+
+    void Clear() { count_ = 0; }
+
+    size_t Size() const { return count_; }
+    size_t Capacity() const { return slots_.size(); }
+    unsigned Interval() const { return interval_; }
+
+    // Steps of the oldest and newest state in the ring, only valid if Size() > 0
+    uint64_t OldestStep() const { return slots_[Slot(0)].Step; }
+    uint64_t NewestStep() const { return slots_[Slot(count_ - 1)].Step; }
+
+private:
+    // Index in slots_ of the i-th oldest state
+    size_t Slot(size_t i) const { return (head_ + i) % slots_.size(); }
+
+    std::vector<WorldState> slots_;
+    unsigned interval_;
+    size_t head_;   // oldest state
+    size_t count_;
+};
+
+#endif
@@ -0,0 +1,719 @@
+#include "scene.h"
+#include "island_threading.h"
+#include "simulation.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+
+namespace
+{
+
+const char SCENE_MAGIC[8] = { 'O', 'D', 'E', 'S', 'C', 'N', 'E', '1' };
+const uint32_t SCENE_VERSION = 1;
+
+struct SceneFileHeader
+{
+    char Magic[8];
+    uint32_t Version;
+    uint32_t NumMaterials;
+    uint64_t NumStatic;
+    uint64_t NumBodies;
+    SceneWorld World;
+};
+
+struct SceneFileMaterial
+{
+    char Name[32];
+    dReal Density;
+    dReal Friction;
+    dReal Bounce;
+    dReal BounceVel;
+    dReal SoftCFM;
+};
+
+const char* SHAPE_NAMES[] = { "box", "sphere", "capsule", "cylinder", "plane" };
+
+// Number of size values each shape takes in the text format
+const int SHAPE_SIZES[] = { 3, 1, 2, 2, 4 };
+
+bool Finite(const dReal* v, int n)
+{
+    for(int i = 0; i < n; ++i)
+    {
+        if (!std::isfinite(v[i]))
+            return false;
+    }
+    return true;
+}
+
+bool Positive(const dReal* v, int n)
+{
+    for(int i = 0; i < n; ++i)
+    {
+        if (!(v[i] > 0 && std::isfinite(v[i])))
+            return false;
+    }
+    return true;
+}
+
+// A rotation that can be normalized, a plane normal that has a direction
+bool NonZero(const dReal* v, int n)
+{
+    dReal sum = 0;
+    for(int i = 0; i < n; ++i)
+        sum += v[i] * v[i];
+    return sum > 0;
+}
+
+// What is wrong with a scene, 0 if nothing. The other loaders and savers index tables with the enums, and ODE asserts
+// on or silently produces invalid masses and geoms from the rest.
+const char* SceneError(const Scene& scene)
+{
+    const SceneWorld& w = scene.World;
+    if (w.Broadphase < BROADPHASE_SIMPLE || w.Broadphase > BROADPHASE_QUADTREE)
+        return "unknown broadphase";
+    if (w.IslandThreads < 0)
+        return "negative island thread count";
+    if (!Finite(w.Gravity, 3) || !Finite(&w.SurfaceLayer, 1) || !Finite(&w.ERP, 1) || !Finite(&w.CFM, 1))
+        return "world parameter is not finite";
+    if (!(w.ERP >= 0 && w.ERP <= 1) || !(w.CFM >= 0) || !(w.MaxCorrectingVel >= 0) || !(w.SurfaceLayer >= 0))
+        return "world parameter out of range";
+
+    if (scene.Materials.size() > MAX_MATERIALS)
+        return "too many materials";
+    for(size_t i = 0; i < scene.Materials.size(); ++i)
+    {
+        const Material& m = scene.Materials[i];
+        if (!Positive(&m.Density, 1))
+            return "material density must be positive";
+        if (!(m.Friction >= 0) || !Finite(&m.Bounce, 1) || !Finite(&m.BounceVel, 1) || !Finite(&m.SoftCFM, 1))
+            return "material parameter is not valid";
+    }
+
+    for(size_t i = 0; i < scene.Static.size(); ++i)
+    {
+        const SceneGeom& g = scene.Static[i];
+        if (g.Shape < SHAPE_BOX || g.Shape > SHAPE_PLANE)
+            return "unknown static geom shape";
+        if (g.Shape == SHAPE_PLANE)
+        {
+            if (!Finite(g.Size, 3) || !NonZero(g.Size, 3) || !Finite(g.Position, 1))
+                return "invalid plane";
+        }
+        else if (!Positive(g.Size, SHAPE_SIZES[g.Shape]) || !Finite(g.Position, 3) ||
+                 !Finite(g.Quaternion, 4) || !NonZero(g.Quaternion, 4))
+            return "invalid static geom size or pose";
+    }
+    for(size_t i = 0; i < scene.Bodies.size(); ++i)
+    {
+        const SceneBody& b = scene.Bodies[i];
+        if (b.Shape < SHAPE_BOX || b.Shape > SHAPE_CYLINDER)
+            return "unknown body shape";
+        if (!Positive(b.Size, SHAPE_SIZES[b.Shape]) || !Finite(b.Position, 3) || !Finite(b.Quaternion, 4) ||
+            !NonZero(b.Quaternion, 4) || !Finite(b.LinearVel, 3) || !Finite(b.AngularVel, 3))
+            return "invalid body size, pose or velocity";
+    }
+    return 0;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+// Splits a line into whitespace separated tokens, in place
+class Tokenizer
+{
+public:
+    Tokenizer(char* line) : p_(line) {}
+
+    const char* Next()
+    {
+        while (*p_ == ' ' || *p_ == '\t' || *p_ == '\r')
+            ++p_;
+        if (*p_ == 0 || *p_ == '#')
+            return 0;
+
+        const char* token = p_;
+        while (*p_ && *p_ != ' ' && *p_ != '\t' && *p_ != '\r')
+            ++p_;
+        if (*p_)
+            *p_++ = 0;
+        return token;
+    }
+
+    bool Numbers(dReal* out, int n)
+    {
+        for(int i = 0; i < n; ++i)
+        {
+            const char* token = Next();
+            if (!token)
+                return false;
+
+            char* end;
+            out[i] = std::strtod(token, &end);
+            if (*end)
+                return false;
+        }
+        return true;
+    }
+
+private:
+    char* p_;
+};
+
+bool ParseShape(const char* name, int& shape)
+{
+    for(int i = 0; i < (int)(sizeof(SHAPE_NAMES) / sizeof(SHAPE_NAMES[0])); ++i)
+    {
+        if (name && std::strcmp(name, SHAPE_NAMES[i]) == 0)
+        {
+            shape = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Optional trailing material name
+bool ParseMaterial(Tokenizer& tok, Scene& scene, std::map<std::string, uint32_t>& names, uint32_t& material)
+{
+    const char* name = tok.Next();
+    if (!name)
+    {
+        material = 0;
+        return true;
+    }
+
+    // Without any material lines the names refer to the default materials
+    if (scene.Materials.empty())
+    {
+        MaterialTable defaults;
+        AddDefaultMaterials(defaults);
+        scene.Materials = defaults.Materials;
+        for(size_t i = 0; i < scene.Materials.size(); ++i)
+            names[scene.Materials[i].Name] = i;
+    }
+
+    std::map<std::string, uint32_t>::const_iterator it = names.find(name);
+    if (it == names.end())
+        return false;
+
+    material = it->second;
+    return true;
+}
+
+void Identity(dReal* q)
+{
+    q[0] = 1;
+    q[1] = q[2] = q[3] = 0;
+}
+
+dGeomID CreateGeom(dSpaceID space, int shape, const dReal* size)
+{
+    switch (shape)
+    {
+    case SHAPE_SPHERE: return dCreateSphere(space, size[0]);
+    case SHAPE_CAPSULE: return dCreateCapsule(space, size[0], size[1]);
+    case SHAPE_CYLINDER: return dCreateCylinder(space, size[0], size[1]);
+    case SHAPE_BOX:
+    default: return dCreateBox(space, size[0], size[1], size[2]);
+    }
+}
+
+void ShapeMass(dMass& m, int shape, dReal density, const dReal* size)
+{
+    // Capsules and cylinders are aligned with the Z axis of the body (direction 3)
+    switch (shape)
+    {
+    case SHAPE_SPHERE: dMassSetSphere(&m, density, size[0]); break;
+    case SHAPE_CAPSULE: dMassSetCapsule(&m, density, 3, size[0], size[1]); break;
+    case SHAPE_CYLINDER: dMassSetCylinder(&m, density, 3, size[0], size[1]); break;
+    case SHAPE_BOX:
+    default: dMassSetBox(&m, density, size[0], size[1], size[2]); break;
+    }
+}
+
+// A count that does not fit into the rest of the file is refused before anything is allocated for it
+template<typename T>
+bool ReadArray(std::FILE* f, std::vector<T>& out, uint64_t n, uint64_t& remaining)
+{
+    if (n > remaining / sizeof(T))
+        return false;
+    remaining -= n * sizeof(T);
+
+    out.resize(n);
+    return n == 0 || std::fread(&out[0], sizeof(T), n, f) == n;
+}
+
+template<typename T>
+bool WriteArray(std::FILE* f, const std::vector<T>& v)
+{
+    return v.empty() || std::fwrite(&v[0], sizeof(T), v.size(), f) == v.size();
+}
+
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+bool LoadScene(const std::string& path, Scene& scene)
+{
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f)
+    {
+        std::cerr << "[LoadScene] Could not open '" << path << "': " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    char magic[sizeof(SCENE_MAGIC)];
+    bool binary = std::fread(magic, 1, sizeof(magic), f) == sizeof(magic)
+                  && std::memcmp(magic, SCENE_MAGIC, sizeof(magic)) == 0;
+    std::fclose(f);
+
+    return binary ? LoadSceneBinary(path, scene) : LoadSceneText(path, scene);
+}
+
+bool LoadSceneText(const std::string& path, Scene& scene)
+{
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f)
+    {
+        std::cerr << "[LoadSceneText] Could not open '" << path << "': " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Read everything at once, the lines are tokenized in place
+    std::string text;
+    char buffer[1 << 16];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), f)) > 0)
+        text.append(buffer, n);
+    std::fclose(f);
+
+    // Count the bodies first so the vector is allocated once
+    scene = Scene();
+    scene.Bodies.reserve(std::count(text.begin(), text.end(), '\n') + 1);
+
+    std::map<std::string, uint32_t> names;
+
+    // Terminate every line, including a last one without a newline
+    text += '\n';
+    std::replace(text.begin(), text.end(), '\n', '\0');
+
+    int line_number = 0;
+    for(size_t pos = 0, next; pos < text.size(); pos = next)
+    {
+        char* line = &text[pos];
+        next = pos + std::strlen(line) + 1;
+        ++line_number;
+
+        Tokenizer tok(line);
+        const char* keyword = tok.Next();
+        if (!keyword)
+            continue;
+
+        bool ok = true;
+        if (std::strcmp(keyword, "world") == 0)
+        {
+            SceneWorld& w = scene.World;
+            while (const char* key = tok.Next())
+            {
+                std::string k = key;
+                if (k == "gravity")
+                    ok = tok.Numbers(w.Gravity, 3);
+                else if (k == "erp")
+                    ok = tok.Numbers(&w.ERP, 1);
+                else if (k == "cfm")
+                    ok = tok.Numbers(&w.CFM, 1);
+                else if (k == "max_correcting_vel")
+                    ok = tok.Numbers(&w.MaxCorrectingVel, 1);
+                else if (k == "surface_layer")
+                    ok = tok.Numbers(&w.SurfaceLayer, 1);
+                else if (k == "auto_disable" || k == "iterations" || k == "island_threads")
+                {
+                    dReal v;
+                    ok = tok.Numbers(&v, 1) && v >= 0 && v <= INT32_MAX;
+                    if (ok)
+                    {
+                        (k == "auto_disable" ? w.AutoDisable : k == "iterations" ? w.QuickStepIterations
+                                                                                 : w.IslandThreads) = (int32_t)v;
+                    }
+                }
+                else if (k == "broadphase")
+                {
+                    const char* name = tok.Next();
+                    BroadphaseType type;
+                    ok = name && ParseBroadphase(name, type);
+                    if (ok)
+                        w.Broadphase = type;
+                }
+                else
+                    ok = false;
+
+                if (!ok)
+                    break;
+            }
+        }
+        else if (std::strcmp(keyword, "material") == 0)
+        {
+            const char* name = tok.Next();
+            Material m;
+            dReal v[5];
+            ok = name && tok.Numbers(v, 5);
+            if (ok)
+            {
+                m.Name = name;
+                m.Density = v[0];
+                m.Friction = v[1];
+                m.Bounce = v[2];
+                m.BounceVel = v[3];
+                m.SoftCFM = v[4];
+                names[m.Name] = scene.Materials.size();
+                scene.Materials.push_back(m);
+            }
+        }
+        else if (std::strcmp(keyword, "plane") == 0)
+        {
+            SceneGeom g;
+            g.Shape = SHAPE_PLANE;
+            Identity(g.Quaternion);
+            g.Position[1] = g.Position[2] = 0;
+            dReal v[4];
+            ok = tok.Numbers(v, 4) && ParseMaterial(tok, scene, names, g.Material);
+            if (ok)
+            {
+                g.Size[0] = v[0];
+                g.Size[1] = v[1];
+                g.Size[2] = v[2];
+                g.Position[0] = v[3];
+                scene.Static.push_back(g);
+            }
+        }
+        else if (std::strcmp(keyword, "static") == 0)
+        {
+            SceneGeom g;
+            g.Size[0] = g.Size[1] = g.Size[2] = 0;
+            ok = ParseShape(tok.Next(), g.Shape) && g.Shape != SHAPE_PLANE
+                 && tok.Numbers(g.Size, SHAPE_SIZES[g.Shape])
+                 && tok.Numbers(g.Position, 3)
+                 && tok.Numbers(g.Quaternion, 4)
+                 && ParseMaterial(tok, scene, names, g.Material);
+            if (ok)
+                scene.Static.push_back(g);
+        }
+        else if (std::strcmp(keyword, "body") == 0)
+        {
+            SceneBody b;
+            b.Size[0] = b.Size[1] = b.Size[2] = 0;
+            ok = ParseShape(tok.Next(), b.Shape) && b.Shape != SHAPE_PLANE
+                 && tok.Numbers(b.Size, SHAPE_SIZES[b.Shape])
+                 && tok.Numbers(b.Position, 3)
+                 && tok.Numbers(b.Quaternion, 4)
+                 && tok.Numbers(b.LinearVel, 3)
+                 && tok.Numbers(b.AngularVel, 3)
+                 && ParseMaterial(tok, scene, names, b.Material);
+            if (ok)
+                scene.Bodies.push_back(b);
+        }
+        else
+            ok = false;
+
+        if (!ok)
+        {
+            std::cerr << "[LoadSceneText] " << path << ":" << line_number << ": could not parse line" << std::endl;
+            return false;
+        }
+    }
+
+    if (const char* error = SceneError(scene))
+    {
+        std::cerr << "[LoadSceneText] '" << path << "': " << error << std::endl;
+        scene = Scene();
+        return false;
+    }
+
+    return true;
+}
+
+bool LoadSceneBinary(const std::string& path, Scene& scene)
+{
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f)
+    {
+        std::cerr << "[LoadSceneBinary] Could not open '" << path << "': " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    SceneFileHeader header;
+    std::vector<SceneFileMaterial> materials;
+
+    // The counts in the header are checked against what is left of the file
+    long size = std::fseek(f, 0, SEEK_END) == 0 ? std::ftell(f) : -1;
+    uint64_t remaining = size > (long)sizeof(header) ? (uint64_t)size - sizeof(header) : 0;
+
+    scene = Scene();
+    bool ok = size >= (long)sizeof(header)
+              && std::fseek(f, 0, SEEK_SET) == 0
+              && std::fread(&header, sizeof(header), 1, f) == 1
+              && std::memcmp(header.Magic, SCENE_MAGIC, sizeof(header.Magic)) == 0
+              && header.Version == SCENE_VERSION
+              && ReadArray(f, materials, header.NumMaterials, remaining)
+              && ReadArray(f, scene.Static, header.NumStatic, remaining)
+              && ReadArray(f, scene.Bodies, header.NumBodies, remaining);
+    std::fclose(f);
+
+    if (!ok)
+    {
+        std::cerr << "[LoadSceneBinary] '" << path << "' is not a valid binary scene file" << std::endl;
+        scene = Scene();
+        return false;
+    }
+
+    scene.World = header.World;
+
+    scene.Materials.resize(materials.size());
+    for(size_t i = 0; i < materials.size(); ++i)
+    {
+        const SceneFileMaterial& in = materials[i];
+        Material& m = scene.Materials[i];
+        m.Name.assign(in.Name, strnlen(in.Name, sizeof(in.Name)));
+        m.Density = in.Density;
+        m.Friction = in.Friction;
+        m.Bounce = in.Bounce;
+        m.BounceVel = in.BounceVel;
+        m.SoftCFM = in.SoftCFM;
+    }
+
+    if (const char* error = SceneError(scene))
+    {
+        std::cerr << "[LoadSceneBinary] '" << path << "': " << error << std::endl;
+        scene = Scene();
+        return false;
+    }
+
+    return true;
+}
+
+bool SaveSceneBinary(const std::string& path, const Scene& scene)
+{
+    if (const char* error = SceneError(scene))
+    {
+        std::cerr << "[SaveSceneBinary] Not writing '" << path << "': " << error << std::endl;
+        return false;
+    }
+
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f)
+    {
+        std::cerr << "[SaveSceneBinary] Could not open '" << path << "': " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    SceneFileHeader header = SceneFileHeader();
+    std::memcpy(header.Magic, SCENE_MAGIC, sizeof(header.Magic));
+    header.Version = SCENE_VERSION;
+    header.NumMaterials = scene.Materials.size();
+    header.NumStatic = scene.Static.size();
+    header.NumBodies = scene.Bodies.size();
+    header.World = scene.World;
+
+    std::vector<SceneFileMaterial> materials(scene.Materials.size());
+    for(size_t i = 0; i < materials.size(); ++i)
+    {
+        const Material& in = scene.Materials[i];
+        SceneFileMaterial& m = materials[i];
+        std::memset(&m, 0, sizeof(m));
+        std::strncpy(m.Name, in.Name.c_str(), sizeof(m.Name) - 1);
+        m.Density = in.Density;
+        m.Friction = in.Friction;
+        m.Bounce = in.Bounce;
+        m.BounceVel = in.BounceVel;
+        m.SoftCFM = in.SoftCFM;
+    }
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1
+              && WriteArray(f, materials)
+              && WriteArray(f, scene.Static)
+              && WriteArray(f, scene.Bodies);
+    ok = std::fclose(f) == 0 && ok;
+
+    if (!ok)
+        std::cerr << "[SaveSceneBinary] Could not write '" << path << "'" << std::endl;
+    return ok;
+}
+
+bool SaveSceneText(const std::string& path, const Scene& scene)
+{
+    if (const char* error = SceneError(scene))
+    {
+        std::cerr << "[SaveSceneText] Not writing '" << path << "': " << error << std::endl;
+        return false;
+    }
+
+    std::FILE* f = std::fopen(path.c_str(), "w");
+    if (!f)
+    {
+        std::cerr << "[SaveSceneText] Could not open '" << path << "': " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    const SceneWorld& w = scene.World;
+    std::fprintf(f, "world gravity %.17g %.17g %.17g erp %.17g cfm %.17g max_correcting_vel %.17g surface_layer %.17g "
+                    "auto_disable %d iterations %d broadphase %s island_threads %d\n",
+                 w.Gravity[0], w.Gravity[1], w.Gravity[2], w.ERP, w.CFM, w.MaxCorrectingVel, w.SurfaceLayer,
+                 w.AutoDisable, w.QuickStepIterations, BroadphaseName((BroadphaseType)w.Broadphase), w.IslandThreads);
+
+    for(size_t i = 0; i < scene.Materials.size(); ++i)
+    {
+        const Material& m = scene.Materials[i];
+        std::fprintf(f, "material %s %.17g %.17g %.17g %.17g %.17g\n", m.Name.c_str(), m.Density, m.Friction,
+                     m.Bounce, m.BounceVel, m.SoftCFM);
+    }
+
+    // Material names are only written if the scene has its own materials, otherwise index 0 is implied
+    for(size_t i = 0; i < scene.Static.size(); ++i)
+    {
+        const SceneGeom& g = scene.Static[i];
+        const char* material = g.Material < scene.Materials.size() ? scene.Materials[g.Material].Name.c_str() : "";
+
+        if (g.Shape == SHAPE_PLANE)
+        {
+            std::fprintf(f, "plane %.17g %.17g %.17g %.17g %s\n", g.Size[0], g.Size[1], g.Size[2], g.Position[0],
+                         material);
+            continue;
+        }
+
+        std::fprintf(f, "static %s", SHAPE_NAMES[g.Shape]);
+        for(int k = 0; k < SHAPE_SIZES[g.Shape]; ++k)
+            std::fprintf(f, " %.17g", g.Size[k]);
+        std::fprintf(f, " %.17g %.17g %.17g %.17g %.17g %.17g %.17g %s\n", g.Position[0], g.Position[1], g.Position[2],
+                     g.Quaternion[0], g.Quaternion[1], g.Quaternion[2], g.Quaternion[3], material);
+    }
+
+    for(size_t i = 0; i < scene.Bodies.size(); ++i)
+    {
+        const SceneBody& b = scene.Bodies[i];
+        const char* material = b.Material < scene.Materials.size() ? scene.Materials[b.Material].Name.c_str() : "";
+
+        std::fprintf(f, "body %s", SHAPE_NAMES[b.Shape]);
+        for(int k = 0; k < SHAPE_SIZES[b.Shape]; ++k)
+            std::fprintf(f, " %.17g", b.Size[k]);
+        std::fprintf(f, " %.17g %.17g %.17g %.17g %.17g %.17g %.17g %.17g %.17g %.17g %.17g %.17g %.17g %s\n",
+                     b.Position[0], b.Position[1], b.Position[2],
+                     b.Quaternion[0], b.Quaternion[1], b.Quaternion[2], b.Quaternion[3],
+                     b.LinearVel[0], b.LinearVel[1], b.LinearVel[2],
+                     b.AngularVel[0], b.AngularVel[1], b.AngularVel[2], material);
+    }
+
+    bool ok = std::fclose(f) == 0;
+    if (!ok)
+        std::cerr << "[SaveSceneText] Could not write '" << path << "'" << std::endl;
+    return ok;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void BuildScene(Simulation& sim, const Scene& scene)
+{
+    const SceneWorld& w = scene.World;
+
+    BroadphaseConfig broadphase;
+    broadphase.Type = (BroadphaseType)w.Broadphase;
+
+    // ODE's quadtree assumes Z is up and splits on X and Y, with gravity along Y it splits the height instead of the
+    // ground
+    if (broadphase.Type == BROADPHASE_QUADTREE && std::fabs(w.Gravity[1]) > std::fabs(w.Gravity[2]))
+        std::cerr << "[BuildScene] The quadtree splits on X and Y, with gravity along Y use hash or sap" << std::endl;
+
+    // A quadtree has to know the region it covers up front, make it fit the bodies
+    if (broadphase.Type == BROADPHASE_QUADTREE && !scene.Bodies.empty())
+    {
+        dReal lo[3], hi[3];
+        for(int k = 0; k < 3; ++k)
+            lo[k] = hi[k] = scene.Bodies[0].Position[k];
+        for(size_t i = 1; i < scene.Bodies.size(); ++i)
+        {
+            for(int k = 0; k < 3; ++k)
+            {
+                lo[k] = std::min(lo[k], scene.Bodies[i].Position[k]);
+                hi[k] = std::max(hi[k], scene.Bodies[i].Position[k]);
+            }
+        }
+        for(int k = 0; k < 3; ++k)
+        {
+            broadphase.QuadTreeCenter[k] = (lo[k] + hi[k]) / 2;
+            broadphase.QuadTreeExtents[k] = (hi[k] - lo[k]) / 2 + 5;
+        }
+    }
+
+    sim.Materials = MaterialTable();
+    for(size_t i = 0; i < scene.Materials.size(); ++i)
+        AddMaterial(sim.Materials, scene.Materials[i]);
+
+    CreateWorld(sim, broadphase);
+
+    dWorldSetGravity(sim.World, w.Gravity[0], w.Gravity[1], w.Gravity[2]);
+    dWorldSetERP(sim.World, w.ERP);
+    dWorldSetCFM(sim.World, w.CFM);
+    dWorldSetContactMaxCorrectingVel(sim.World, w.MaxCorrectingVel);
+    dWorldSetContactSurfaceLayer(sim.World, w.SurfaceLayer);
+    dWorldSetQuickStepNumIterations(sim.World, w.QuickStepIterations);
+
+    // Bodies copy the world's auto disable settings when they are created, so this has to come first
+    dWorldSetAutoDisableFlag(sim.World, w.AutoDisable);
+
+    size_t num_materials = sim.Materials.Materials.size();
+
+    for(size_t i = 0; i < scene.Static.size(); ++i)
+    {
+        const SceneGeom& g = scene.Static[i];
+        MaterialID material = g.Material < num_materials ? g.Material : 0;
+
+        if (g.Shape == SHAPE_PLANE)
+        {
+            AddPlane(sim, g.Size[0], g.Size[1], g.Size[2], g.Position[0], material);
+            continue;
+        }
+
+        dGeomID geom = CreateGeom(sim.StaticSpace, g.Shape, g.Size);
+        dGeomSetPosition(geom, g.Position[0], g.Position[1], g.Position[2]);
+        dGeomSetQuaternion(geom, g.Quaternion);
+        SetGeomMaterial(geom, material);
+    }
+
+    // Everything for the bodies is allocated in one go, only the ODE objects themselves are created one by one
+    sim.Objects.reserve(sim.Objects.size() + scene.Bodies.size());
+
+    for(size_t i = 0; i < scene.Bodies.size(); ++i)
+    {
+        const SceneBody& b = scene.Bodies[i];
+        MaterialID material = b.Material < num_materials ? b.Material : 0;
+
+        MyObject object;
+        object.Body = dBodyCreate(sim.World);
+        dBodySetPosition(object.Body, b.Position[0], b.Position[1], b.Position[2]);
+        dBodySetQuaternion(object.Body, b.Quaternion);
+        dBodySetLinearVel(object.Body, b.LinearVel[0], b.LinearVel[1], b.LinearVel[2]);
+        dBodySetAngularVel(object.Body, b.AngularVel[0], b.AngularVel[1], b.AngularVel[2]);
+        dBodySetData(object.Body, (void*)sim.Objects.size());
+
+        dMass m;
+        ShapeMass(m, b.Shape, sim.Materials.Materials[material].Density, b.Size);
+        dBodySetMass(object.Body, &m);
+
+        object.Geom[0] = CreateGeom(sim.Space, b.Shape, b.Size);
+        dGeomSetBody(object.Geom[0], object.Body);
+        SetGeomMaterial(object.Geom[0], material);
+
+        sim.Objects.push_back(object);
+    }
+
+    TuneSpaces(sim);
+
+    // Without threading support in ODE this fails and the world keeps solving its islands on the calling thread
+    if (w.IslandThreads > 1)
+        EnableIslandThreading(sim, (unsigned)w.IslandThreads);
+}
@@ -0,0 +1,104 @@
+#ifndef ODE_EXAMPLE_SCENE_H
+#define ODE_EXAMPLE_SCENE_H
+
+#include "broadphase.h"
+#include "material.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct Simulation;
+
+// Scene description: world and solver parameters, materials, static geometry and bodies. There are two file formats
+// holding the same data:
+//
+// Text (.scene), one item per line, '#' starts a comment. Sizes are box side lengths, sphere radius, or capsule /
+// cylinder radius and length. Rotations are quaternions (w x y z). The material name is optional and defaults to the
+// first material.
+//
+//     world gravity 0 -1 0 erp 0.2 cfm 1e-5 max_correcting_vel 0.9 surface_layer 0.001 auto_disable 1
+//           iterations 20 broadphase simple island_threads 0
+//     material <name> <density> <friction|inf> <bounce> <bounce_vel> <soft_cfm>
+//     plane <nx> <ny> <nz> <d> [material]
+//     static <box|sphere|capsule|cylinder> <size...> <x y z> <qw qx qy qz> [material]
+//     body <box|sphere|capsule|cylinder> <size...> <x y z> <qw qx qy qz> <vx vy vz> <wx wy wz> [material]
+//
+// Binary (anything else), a header followed by the material, static geom and body arrays exactly as they are laid
+// out in memory. Loading is one read per array into preallocated vectors, nothing is parsed per object. The binary
+// files use the native byte order and are meant as a cache of the text files, not for exchange between machines.
+
+enum SceneShape
+{
+    SHAPE_BOX,
+    SHAPE_SPHERE,
+    SHAPE_CAPSULE,
+    SHAPE_CYLINDER,
+    SHAPE_PLANE  // static geometry only
+};
+
+struct SceneWorld
+{
+    dReal Gravity[3];
+    dReal ERP;
+    dReal CFM;
+    dReal MaxCorrectingVel;
+    dReal SurfaceLayer;
+    int32_t AutoDisable;
+    int32_t QuickStepIterations;
+    int32_t Broadphase;     // BroadphaseType
+    int32_t IslandThreads;  // more than 1 solves islands in parallel, see EnableIslandThreading
+
+    // The values InitODE always used
+    SceneWorld() : ERP(0.2), CFM(1e-5), MaxCorrectingVel(0.9), SurfaceLayer(0.001), AutoDisable(1),
+                   QuickStepIterations(20), Broadphase(BROADPHASE_SIMPLE), IslandThreads(0)
+    {
+        Gravity[0] = 0;
+        Gravity[1] = -1.0;
+        Gravity[2] = 0;
+    }
+};
+
+// A geom without a body. For planes Size holds the normal and Position[0] the distance.
+struct SceneGeom
+{
+    int32_t Shape;
+    uint32_t Material;
+    dReal Size[3];
+    dReal Position[3];
+    dReal Quaternion[4];
+};
+
+// A body with a single geom
+struct SceneBody
+{
+    int32_t Shape;
+    uint32_t Material;
+    dReal Size[3];
+    dReal Position[3];
+    dReal Quaternion[4];
+    dReal LinearVel[3];
+    dReal AngularVel[3];
+};
+
+struct Scene
+{
+    SceneWorld World;
+    std::vector<Material> Materials;
+    std::vector<SceneGeom> Static;
+    std::vector<SceneBody> Bodies;
+};
+
+// Picks the format from the first bytes of the file. Returns false and prints the reason if it could not be loaded.
+bool LoadScene(const std::string& path, Scene& scene);
+bool LoadSceneText(const std::string& path, Scene& scene);
+bool LoadSceneBinary(const std::string& path, Scene& scene);
+
+bool SaveSceneText(const std::string& path, const Scene& scene);
+bool SaveSceneBinary(const std::string& path, const Scene& scene);
+
+// Builds the scene into an empty Simulation, the same way InitODE builds the example scene. If the scene has no
+// materials the default ones are used.
+void BuildScene(Simulation& sim, const Scene& scene);
+
+#endif
@@ -0,0 +1,390 @@
+// TAKEN AND SLIGHTLY ADAPTED FROM http://www.alsprogrammingresource.com/basic_ode.html
+
+#include "simulation.h"
+#include "island_threading.h"
+#include "output.h"
+#include "rewind.h"
+
+void CreateWorld(Simulation& sim, const BroadphaseConfig& broadphase)
+{
+    sim.Broadphase = broadphase;
+
+    // Create a new, empty world and assign its ID number to World. Most applications will only need one world.
+    sim.World = dWorldCreate();
+
+    // Create a new collision space and assign its ID number to Space, passing 0 instead of an existing dSpaceID.
+    // There are different types of collision spaces we could create here depending on the number of objects in the
+    // world. dSimpleSpaceCreate is fine for a small number of objects, for more objects dHashSpaceCreate,
+    // dSweepAndPruneSpaceCreate or dQuadTreeSpaceCreate are better choices. Which one is used is up to the caller,
+    // see broadphase.h.
+    sim.Space = CreateSpace(broadphase);
+
+    // Static geometry gets a space of its own. SimLoop only ever tests it against the dynamic space, so pairs of
+    // static geoms are never looked at and the broadphase cost only grows with the number of moving geoms.
+    sim.StaticSpace = CreateSpace(broadphase);
+
+    // Create a joint group object and assign its ID number to contactgroup. dJointGroupCreate used to have a
+    // max_size parameter but it is no longer used so we just pass 0 as its argument.
+    sim.contactgroup = dJointGroupCreate(0);
+
+    // Now we set the gravity vector for our world by passing World as the first argument to dWorldSetGravity.
+    // Earth's gravity vector would be (0, -9.81, 0) assuming that +Y is up. I found that a lighter gravity looked
+    // more realistic in this case.
+    dWorldSetGravity(sim.World, 0, -1.0, 0);
+
+    // These next two functions control how much error correcting and constraint force mixing occurs in the world.
+    // Don't worry about these for now as they are set to the default values and we could happily delete them from
+    // this example. Different values, however, can drastically change the behaviour of the objects colliding, so
+    // I suggest you look up the full info on them in the ODE docs.
+    dWorldSetERP(sim.World, 0.2);
+    dWorldSetCFM(sim.World, 1e-5);
+
+    // This function sets the velocity that interpenetrating objects will separate at. The default value is infinity.
+    dWorldSetContactMaxCorrectingVel(sim.World, 0.9);
+
+    // This function sets the depth of the surface layer around the world objects. Contacts are allowed to sink into
+    // each other up to this depth. Setting it to a small value reduces the amount of jittering between contacting
+    // objects, the default value is 0.
+    dWorldSetContactSurfaceLayer(sim.World, 0.001);
+
+    // To save some CPU time we set the auto disable flag to 1. This means that objects that have come to rest (based
+    // on their current linear and angular velocity) will no longer participate in the simulation, unless acted upon
+    // by a moving object. If you do not want to use this feature then set the flag to 0. You can also manually enable
+    // or disable objects using dBodyEnable and dBodyDisable, see the docs for more info on this.
+    dWorldSetAutoDisableFlag(sim.World, 1);
+
+    // dWorldQuickStep allocates its temporary memory from an arena that is kept between steps, see step_memory.h
+    ApplyStepMemoryConfig(sim);
+
+    // Now we set up the joint properties of the contacts. Going into the full details here would require a tutorial
+    // of its own. I'll just say that the dSurfaceParameters of a contact control the joint behaviour, such as
+    // friction, velocity and bounciness. See section 7.3.7 of the ODE manual and have fun experimenting to learn more.
+    // Every geom is made of a material, the surface for each pair of materials is combined once here so the near
+    // callback only has to look it up. Material 0 is what this example always used.
+    if (sim.Materials.Materials.empty())
+        AddDefaultMaterials(sim.Materials);
+    BuildSurfaces(sim.Materials);
+}
+
+dGeomID AddPlane(Simulation& sim, dReal a, dReal b, dReal c, dReal d, MaterialID material)
+{
+    // Create a plane in our static collision space by passing StaticSpace as the first argument to dCreatePlane.
+    // The next four parameters are the planes normal (a, b, c) and distance (d) according to the plane equation
+    // a*x+b*y+c*z=d and must have length 1
+    dGeomID plane = dCreatePlane(sim.StaticSpace, a, b, c, d);
+
+    // An id the table does not know is a bug of the caller, the near callback would take it as material 0
+    assert(material < sim.Materials.Materials.size());
+    if (material >= sim.Materials.Materials.size())
+        material = 0;
+
+    // The geom's user data holds its material, that is what the near callback uses to find the contact surface
+    SetGeomMaterial(plane, material);
+    return plane;
+}
+
+size_t AddBox(Simulation& sim, const dReal* pos, const dReal* sides, const dMatrix3 R, MaterialID material)
+{
+    // Create a new body for our object in the world and get its ID.
+    MyObject object;
+    object.Body = dBodyCreate(sim.World);
+
+    // Next we set the position of the new body
+    dBodySetPosition(object.Body, pos[0], pos[1], pos[2]);
+
+    // Here I have set the initial linear velocity to stationary and let gravity do the work, but you can experiment
+    // with the velocity vector to change the starting behaviour. You can also set the rotational velocity for the new
+    // body using dBodySetAngularVel which takes the same parameters.
+    dBodySetLinearVel(object.Body, 0, 0, 0);
+
+    // The initial orientation is passed to dBodySetRotation as a rotation matrix
+    dBodySetRotation(object.Body, R);
+
+    // We store the index of the object in sim.Objects as user data so a body can be mapped back to its MyObject.
+    size_t i = sim.Objects.size();
+    dBodySetData(object.Body, (void*)i);
+
+    // Now we need to create a box mass to go with our geom. First we create a new dMass structure (the internals
+    // of which aren't important at the moment) and pass it to dMassSetBox together with the side lengths of our box
+    // along the x, y and z axes and the density of the material the box is made of.
+    // The density of an id the table does not know would be read from past its end
+    assert(material < sim.Materials.Materials.size());
+    if (material >= sim.Materials.Materials.size())
+        material = 0;
+
+    dMass m;
+    dMassSetBox(&m, sim.Materials.Materials[material].Density, sides[0], sides[1], sides[2]);
+
+    // We can then apply this mass to our objects body.
+    dBodySetMass(object.Body, &m);
+
+    // Here we create the actual geom object using dCreateBox. Note that this also adds the geom to our
+    // collision space and sets the size of the geom to that of our box mass.
+    object.Geom[0] = dCreateBox(sim.Space, sides[0], sides[1], sides[2]);
+
+    // And lastly we want to associate the body with the geom using dGeomSetBody. Setting a body on a geom automatically
+    // combines the position vector and rotation matrix of the body and geom so that setting the position or orientation
+    // of one will set the value for both objects. The ODE docs have a lot more to say about the geom functions.
+    dGeomSetBody(object.Geom[0], object.Body);
+
+    // The geom's user data holds its material, that is what the near callback uses to find the contact surface
+    SetGeomMaterial(object.Geom[0], material);
+
+    sim.Objects.push_back(object);
+    return i;
+}
+
+void TuneSpaces(Simulation& sim)
+{
+    // Now that all geoms are in the spaces, let the broadphase adapt to their sizes
+    TuneBroadphase(sim.Space, sim.Broadphase);
+    TuneBroadphase(sim.StaticSpace, sim.Broadphase);
+}
+
+void InitODE(Simulation& sim, const BroadphaseConfig& broadphase)
+{
+    CreateWorld(sim, broadphase);
+
+    // The ground is a plane through the origin with +Y as its normal
+    AddPlane(sim, 0, 1, 0, 0);
+
+    // This brings us to the end of the world settings, now we have to initialize the objects themselves. We drop a
+    // single 2x2x2 box made of the default material from a height of 10.
+    dReal pos[3] = { 0, 10, -5 };
+    dReal sides[3] = { 2.0, 2.0, 2.0 };
+
+    // To start the object with a different rotation in every world we create a new matrix called R and use the
+    // function dRFromAxisAndAngle to create a random initial rotation before passing this matrix to dBodySetRotation.
+    // The numbers come from the world's own stream (see RandomStream), one after the other into variables, because
+    // the order in which function arguments are evaluated is up to the compiler.
+    dReal axis[3];
+    for(int k = 0; k < 3; ++k)
+        axis[k] = sim.Random.Uniform(-1.0, 1.0);
+    dReal angle = sim.Random.Uniform(-5.0, 5.0);
+
+    dMatrix3 R;
+    dRFromAxisAndAngle(R, axis[0], axis[1], axis[2], angle);
+
+    AddBox(sim, pos, sides, R, 0);
+
+    TuneSpaces(sim);
+}
+
+void CloseODE(Simulation& sim)
+{
+    // Stop the island threads before the world they work on goes away
+    DisableIslandThreading(sim);
+
+    // Destroy all joints in our joint group
+    dJointGroupDestroy(sim.contactgroup);
+
+    // Destroy the collision space. When a space is destroyed, and its cleanup mode is 1 (the default)
+    // then all the geoms in that space are automatically destroyed as well.
+    dSpaceDestroy(sim.Space);
+    dSpaceDestroy(sim.StaticSpace);
+
+    // Destroy the world and everything in it. This includes all bodies and all joints that are not part of a joint group.
+    dWorldDestroy(sim.World);
+
+    sim.Objects.clear();
+    sim.World = 0;
+    sim.Space = 0;
+    sim.StaticSpace = 0;
+    sim.contactgroup = 0;
+    sim.StepCount = 0;
+    sim.ContactCount = 0;
+    sim.RestStep = NOT_AT_REST;
+    ReleaseBallistic(sim);
+}
+
+static void nearCallback (void *data, dGeomID o1, dGeomID o2)
+{
+    // The Simulation this pair belongs to is handed to us by SimLoop through dSpaceCollide's data pointer
+    Simulation* sim = static_cast<Simulation*>(data);
+
+    // If one of the two is a space (which happens when spaces are nested) we collide the contents of the two with each
+    // other, which calls us back with the actual geoms
+    if (dGeomIsSpace(o1) || dGeomIsSpace(o2))
+    {
+        dSpaceCollide2(o1, o2, data, &nearCallback);
+        return;
+    }
+
+    // Temporary index for each contact
+    int i;
+
+    // Get the dynamics body for each geom
+    dBodyID b1 = dGeomGetBody(o1);
+    dBodyID b2 = dGeomGetBody(o2);
+
+    // Create an array of dContact objects to hold the contact joints
+    dContact contact[MAX_CONTACTS];
+
+    StepProfile* profile = sim->Profile;
+    double t_collide = profile ? ProfileClock() : 0;
+
+    // Here we do the actual collision test by calling dCollide. It returns the number of actual contact points or zero
+    // if there were none. As well as the geom IDs, max number of contacts we also pass the address of a dContactGeom
+    // as the fourth parameter. dContactGeom is a substructure of a dContact object so we simply pass the address of
+    // the first dContactGeom from our array of dContact objects and then pass the offset to the next dContactGeom
+    // as the fifth paramater, which is the size of a dContact structure. That made sense didn't it?
+    int numc = dCollide(o1, o2, MAX_CONTACTS, &contact[0].geom, sizeof(dContact));
+
+    double t_contacts = profile ? ProfileClock() : 0;
+
+    if (numc)
+    {
+        // The surface only depends on the materials of the two geoms, so it is looked up once per pair
+        const dSurfaceParameters& surface = LookupSurface(sim->Materials, GetGeomMaterial(o1), GetGeomMaterial(o2));
+
+        // To add each contact point found to our joint group we call dJointCreateContact which is just one of the many
+        // different joint types available.
+        for (i = 0; i < numc; i++)
+        {
+            // dJointCreateContact needs to know which world and joint group to work with as well as the dContact
+            // object itself. It returns a new dJointID which we then use with dJointAttach to finally create the
+            // temporary contact joint between the two geom bodies.
+            contact[i].surface = surface;
+            dJointID c = dJointCreateContact(sim->World, sim->contactgroup, contact + i);
+            dJointAttach(c, b1, b2);
+        }
+        sim->ContactCount += numc;
+    }
+
+    if (profile)
+    {
+        double t_end = ProfileClock();
+        profile->Seconds[PHASE_NARROWPHASE] += t_contacts - t_collide;
+        profile->Seconds[PHASE_CONTACTS] += t_end - t_contacts;
+        profile->Pairs += 1;
+        profile->Contacts += numc;
+    }
+}
+
+void SimLoop(Simulation& sim, double dt)
+{
+    StepProfile* profile = sim.Profile;
+    double t_start = 0;
+    if (profile)
+    {
+        profile->Reset();
+        t_start = ProfileClock();
+    }
+
+    // Bodies in free fall far away from everything else do not need collision detection or the solver, they are moved
+    // analytically by EndBallisticStep below. If that applies to every awake body there is nothing left to do here.
+    bool skip_solver = sim.BallisticFastForward && BeginBallisticStep(sim, dt);
+
+    // dSpaceCollide determines which pairs of geoms in the space we pass to it may potentially intersect. We must also
+    // pass the address of a callback function that we will provide. The callback function is responsible for
+    // determining which of the potential intersections are actual collisions before adding the collision joints to our
+    // joint group called contactgroup, this gives us the chance to set the behaviour of these joints before adding them
+    // to the group. The second parameter is a pointer to any data that we may want to pass to our callback routine,
+    // we pass the Simulation so the callback knows which world and joint group to add the contacts to. We will cover
+    // the details of the nearCallback routine in the next section.
+    if (!skip_solver)
+    {
+        if (sim.NarrowphasePool)
+        {
+            // Same thing, but the dCollide calls are spread over a thread pool
+            CollideParallel(sim, *sim.NarrowphasePool);
+        }
+        else
+        {
+            dSpaceCollide(sim.Space, &sim, &nearCallback);
+
+            // The dynamic geoms also have to be tested against the static ones. dSpaceCollide2 only reports pairs
+            // with one geom from each space, so static geoms are never tested against each other.
+            dSpaceCollide2((dGeomID)sim.Space, (dGeomID)sim.StaticSpace, &sim, &nearCallback);
+        }
+    }
+
+    // Now we advance the simulation by calling dWorldQuickStep. This is a faster version of dWorldStep but it is also
+    // slightly less accurate. As well as the World object ID we also pass a step size value. In each step the simulation
+    // is updated by a certain number of smaller steps or iterations. The default number of iterations is 20 but you can
+    // change this by calling dWorldSetQuickStepNumIterations.
+    double t_step = profile ? ProfileClock() : 0;
+
+    if (!skip_solver)
+    {
+        StepMemoryScope memory(sim);
+        dWorldQuickStep(sim.World, dt);
+    }
+
+    double t_empty = profile ? ProfileClock() : 0;
+
+    // Remove all temporary collision joints now that the world has been stepped
+    dJointGroupEmpty(sim.contactgroup);
+
+    if (profile)
+    {
+        // Whatever the collision phase spent outside the near callback is broadphase
+        profile->Seconds[PHASE_BROADPHASE] = (t_step - t_start) - profile->Seconds[PHASE_NARROWPHASE]
+                                                                 - profile->Seconds[PHASE_CONTACTS];
+        profile->Seconds[PHASE_STEP] = t_empty - t_step;
+        profile->Seconds[PHASE_EMPTY] = ProfileClock() - t_empty;
+    }
+
+    if (sim.BallisticFastForward)
+        EndBallisticStep(sim, dt);
+
+    ++sim.StepCount;
+    sim.InputPending = false;
+
+    // Hand the new state to the output stage. This only copies into a preallocated ring slot, the actual writing
+    // happens on the output thread.
+    if (sim.Output)
+        sim.Output->Push(sim.StepCount, sim);
+
+    if (sim.Rewind)
+        sim.Rewind->Capture(sim);
+
+    // And we finish by calling DrawGeom which renders the objects according to their type or class
+    //    DrawGeom(sim.Objects[0].Geom[0], 0, 0, 0);
+}
+
+bool AtRest(const Simulation& sim)
+{
+    if (sim.InputPending)
+        return false;
+
+    for(size_t i = 0; i < sim.Objects.size(); ++i)
+    {
+        if (dBodyIsEnabled(sim.Objects[i].Body))
+            return false;
+    }
+    return true;
+}
+
+uint64_t RunSteps(Simulation& sim, double dt, uint64_t num_steps, RestPolicy policy)
+{
+    uint64_t end = sim.StepCount + num_steps;
+    uint64_t steps = 0;
+
+    for(;;)
+    {
+        // Also after the last step, so a world that comes to rest on it gets its RestStep right away
+        if (AtRest(sim))
+        {
+            if (sim.RestStep == NOT_AT_REST)
+                sim.RestStep = sim.StepCount;
+
+            // The state will not change anymore, stepping further would only repeat it
+            if (policy == REST_FAST_FORWARD && sim.StepCount < end)
+            {
+                sim.StepCount = end;
+                if (sim.Output)
+                    sim.Output->Push(sim.StepCount, sim);
+            }
+            break;
+        }
+
+        if (sim.StepCount >= end)
+            break;
+
+        SimLoop(sim, dt);
+        ++steps;
+    }
+
+    return steps;
+}
@@ -0,0 +1,125 @@
+#ifndef ODE_EXAMPLE_SIMULATION_H
+#define ODE_EXAMPLE_SIMULATION_H
+
+#include "ballistic.h"
+#include "broadphase.h"
+#include "material.h"
+#include "narrowphase.h"
+#include "profile.h"
+#include "random_stream.h"
+#include "step_memory.h"
+
+#include <stdint.h>
+#include <vector>
+
+class OutputPipeline;
+class RewindBuffer;
+class ThreadPool;
+
+#define GEOMSPERBODY 1  // maximum number of geometries per body
+
+// Simulation::RestStep of a world that has not come to rest yet
+const uint64_t NOT_AT_REST = ~(uint64_t)0;
+
+struct MyObject
+{
+    dBodyID Body;  // the dynamics body
+    dGeomID Geom[GEOMSPERBODY];  // geometries representing this body
+};
+
+// Everything that belongs to one simulated world. Nothing in here is shared with other Simulation instances, so
+// several of them can live (and be stepped on different threads) in the same process. A pointer to the Simulation is
+// what gets passed through the data argument of dSpaceCollide, which is how nearCallback finds its world and joint
+// group.
+struct Simulation
+{
+    dWorldID World;
+    dSpaceID Space;        // geoms attached to bodies, these can move
+    dSpaceID StaticSpace;  // geoms without a body (ground plane, walls), never moved and never tested against each other
+    dJointGroupID contactgroup;
+    std::vector<MyObject> Objects;
+
+    // Materials and their combined contact surfaces. Fill it before calling InitODE to use other materials than the
+    // defaults, InitODE builds the surface matrix.
+    MaterialTable Materials;
+
+    BroadphaseConfig Broadphase;  // what Space and StaticSpace were created with
+
+    // How dWorldQuickStep reserves its temporary memory. Set it before InitODE, or call ApplyStepMemoryConfig after
+    // changing it.
+    StepMemoryConfig StepMemory;
+
+    // Random numbers for building the scene. Seed it with RandomStream(run_id, world_index) before InitODE to give
+    // every world of a run its own reproducible initial state.
+    RandomStream Random;
+
+    // If set, SimLoop runs the narrowphase on this pool (see CollideParallel) instead of inside dSpaceCollide
+    ThreadPool* NarrowphasePool;
+    NarrowphaseBuffers Narrowphase;
+
+    // ODE's own threading for solving islands in parallel, see EnableIslandThreading
+    dThreadingImplementationID Threading;
+    dThreadingThreadPoolID ThreadingPool;
+
+    // If set, free falling bodies far from everything else are moved analytically, see ballistic.h
+    bool BallisticFastForward;
+    BallisticState Ballistic;
+
+    uint64_t StepCount;  // number of SimLoop calls so far (including steps skipped by RunSteps)
+
+    uint64_t ContactCount;  // contact joints created by all SimLoop calls so far
+
+    // Set this when something outside the simulation (a controller, user input) is about to apply forces or move
+    // bodies. A world with pending input is never considered at rest. SimLoop clears it.
+    bool InputPending;
+
+    // StepCount at which RunSteps found every body disabled, NOT_AT_REST if that has not happened yet
+    uint64_t RestStep;
+
+    OutputPipeline* Output;  // if set, SimLoop pushes the body states after every step
+
+    RewindBuffer* Rewind;  // if set, SimLoop captures the body states into it for rolling back
+
+    StepProfile* Profile;  // if set, SimLoop records how long each phase of the last step took
+
+    // If set and StepMemory.Instrument is on, the arena activity of this world is counted here, see StepMemoryStats
+    StepMemoryStats* MemoryStats;
+
+    Simulation() : World(0), Space(0), StaticSpace(0), contactgroup(0), NarrowphasePool(0), Threading(0),
+                   ThreadingPool(0), BallisticFastForward(false), StepCount(0), ContactCount(0), InputPending(false),
+                   RestStep(NOT_AT_REST), Output(0), Rewind(0), Profile(0), MemoryStats(0) {}
+};
+
+// dInitODE2 / dCloseODE are process wide and must be called once around all Simulation instances, they are not part
+// of InitODE / CloseODE anymore.
+
+// Builds the example scene: CreateWorld, a ground plane, one box with a random orientation and TuneSpaces
+void InitODE(Simulation& sim, const BroadphaseConfig& broadphase = BroadphaseConfig());
+
+// Building blocks for other scenes. CreateWorld sets up the world, spaces and materials, AddPlane adds a static plane
+// and AddBox a dynamic box whose index in sim.Objects it returns. Call TuneSpaces once all objects have been added.
+void CreateWorld(Simulation& sim, const BroadphaseConfig& broadphase = BroadphaseConfig());
+dGeomID AddPlane(Simulation& sim, dReal a, dReal b, dReal c, dReal d, MaterialID material = 0);
+size_t AddBox(Simulation& sim, const dReal* pos, const dReal* sides, const dMatrix3 R, MaterialID material = 0);
+void TuneSpaces(Simulation& sim);
+
+// True if auto disable has put every body to sleep and no input is pending. Nothing will move anymore until
+// something from outside wakes a body up.
+bool AtRest(const Simulation& sim);
+
+// What RunSteps does once the world is at rest
+enum RestPolicy
+{
+    REST_STOP,          // return right away, StepCount is the step at which the world came to rest
+    REST_FAST_FORWARD   // skip the remaining steps: StepCount jumps to the end and the final state is output once
+};
+
+// Calls SimLoop up to num_steps times, but stops as soon as the world is at rest. Rest is checked before every step and
+// after the last one, the step at which it was first seen is recorded in sim.RestStep. Returns the number of SimLoop
+// calls made.
+uint64_t RunSteps(Simulation& sim, double dt, uint64_t num_steps, RestPolicy policy = REST_FAST_FORWARD);
+
+void CloseODE(Simulation& sim);
+void SimLoop(Simulation& sim, double dt);
+
+#endif
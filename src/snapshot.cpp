@@ -0,0 +1,168 @@
+#include "snapshot.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+const char SNAPSHOT_MAGIC[8] = { 'O', 'D', 'E', 'S', 'N', 'A', 'P', '1' };
+const uint32_t SNAPSHOT_VERSION = 1;
+
+struct SnapshotFileHeader
+{
+    char Magic[8];
+    uint32_t Version;
+    uint32_t RecordSize;  // sizeof(SnapshotBody), catches files written with a different dReal
+    uint64_t NumBodies;
+    uint64_t StepCount;
+    uint64_t RestStep;
+};
+
+void CaptureBody(dBodyID body, SnapshotBody& s)
+{
+    std::memset(&s, 0, sizeof(s));
+
+    std::memcpy(s.Position, dBodyGetPosition(body), sizeof(s.Position));
+    std::memcpy(s.Quaternion, dBodyGetQuaternion(body), sizeof(s.Quaternion));
+    std::memcpy(s.LinearVel, dBodyGetLinearVel(body), sizeof(s.LinearVel));
+    std::memcpy(s.AngularVel, dBodyGetAngularVel(body), sizeof(s.AngularVel));
+
+    s.AutoDisableLinearThreshold = dBodyGetAutoDisableLinearThreshold(body);
+    s.AutoDisableAngularThreshold = dBodyGetAutoDisableAngularThreshold(body);
+    s.AutoDisableTime = dBodyGetAutoDisableTime(body);
+    s.AutoDisableSteps = dBodyGetAutoDisableSteps(body);
+    s.AutoDisableAverageSamples = dBodyGetAutoDisableAverageSamplesCount(body);
+    s.AutoDisable = dBodyGetAutoDisableFlag(body) ? 1 : 0;
+    s.Enabled = dBodyIsEnabled(body) ? 1 : 0;
+}
+
+void RestoreBody(dBodyID body, const SnapshotBody& s)
+{
+    dBodySetPosition(body, s.Position[0], s.Position[1], s.Position[2]);
+    dBodySetQuaternion(body, s.Quaternion);
+    dBodySetLinearVel(body, s.LinearVel[0], s.LinearVel[1], s.LinearVel[2]);
+    dBodySetAngularVel(body, s.AngularVel[0], s.AngularVel[1], s.AngularVel[2]);
+
+    dBodySetAutoDisableFlag(body, s.AutoDisable);
+    dBodySetAutoDisableLinearThreshold(body, s.AutoDisableLinearThreshold);
+    dBodySetAutoDisableAngularThreshold(body, s.AutoDisableAngularThreshold);
+    dBodySetAutoDisableTime(body, s.AutoDisableTime);
+    dBodySetAutoDisableSteps(body, s.AutoDisableSteps);
+    dBodySetAutoDisableAverageSamplesCount(body, s.AutoDisableAverageSamples);
+
+    // Last, enabling a body resets its idle counters
+    if (s.Enabled)
+        dBodyEnable(body);
+    else
+        dBodyDisable(body);
+}
+
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+bool SaveSnapshot(const std::string& path, const Simulation& sim)
+{
+    SnapshotFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.Magic, SNAPSHOT_MAGIC, sizeof(header.Magic));
+    header.Version = SNAPSHOT_VERSION;
+    header.RecordSize = sizeof(SnapshotBody);
+    header.NumBodies = sim.Objects.size();
+    header.StepCount = sim.StepCount;
+    header.RestStep = sim.RestStep;
+
+    std::vector<SnapshotBody> bodies(sim.Objects.size());
+    for(size_t i = 0; i < bodies.size(); ++i)
+        CaptureBody(sim.Objects[i].Body, bodies[i]);
+
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f)
+    {
+        std::cerr << "[SaveSnapshot] Could not open '" << path << "': " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1
+              && (bodies.empty() || std::fwrite(&bodies[0], sizeof(SnapshotBody), bodies.size(), f) == bodies.size());
+    ok = std::fclose(f) == 0 && ok;
+
+    if (!ok)
+        std::cerr << "[SaveSnapshot] Could not write '" << path << "'" << std::endl;
+    return ok;
+}
+
+bool LoadSnapshot(const std::string& path, Simulation& sim)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "[LoadSnapshot] Could not open '" << path << "': " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotFileHeader))
+    {
+        std::cerr << "[LoadSnapshot] '" << path << "' is not a snapshot file" << std::endl;
+        close(fd);
+        return false;
+    }
+
+    size_t size = st.st_size;
+    void* p = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        std::cerr << "[LoadSnapshot] Could not map '" << path << "': " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // The records are read once from front to back. The advice values are not flags, each takes its own call. Both
+    // are only hints, the file reads the same without them, so a failure is ignored.
+    (void)madvise(p, size, MADV_SEQUENTIAL);
+    (void)madvise(p, size, MADV_WILLNEED);
+
+    const unsigned char* data = static_cast<const unsigned char*>(p);
+    SnapshotFileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    bool ok = std::memcmp(header.Magic, SNAPSHOT_MAGIC, sizeof(header.Magic)) == 0
+              && header.Version == SNAPSHOT_VERSION
+              && header.RecordSize == sizeof(SnapshotBody)
+              && header.NumBodies <= (size - sizeof(header)) / sizeof(SnapshotBody);
+    if (!ok)
+        std::cerr << "[LoadSnapshot] '" << path << "' is not a valid snapshot file" << std::endl;
+    else if (header.NumBodies != sim.Objects.size())
+    {
+        std::cerr << "[LoadSnapshot] '" << path << "' holds " << header.NumBodies << " bodies, the world has "
+                  << sim.Objects.size() << std::endl;
+        ok = false;
+    }
+
+    if (ok)
+    {
+        // The header is 40 bytes, so the records are aligned well enough for dReal in a page aligned mapping
+        const SnapshotBody* bodies = reinterpret_cast<const SnapshotBody*>(data + sizeof(header));
+        for(size_t i = 0; i < sim.Objects.size(); ++i)
+            RestoreBody(sim.Objects[i].Body, bodies[i]);
+
+        sim.StepCount = header.StepCount;
+        sim.RestStep = header.RestStep;
+
+        // Flights in progress were computed from the old state, let the next step pick them again
+        CancelBallisticFlights(sim);
+    }
+
+    munmap(p, size);
+    return ok;
+}
@@ -0,0 +1,41 @@
+#ifndef ODE_EXAMPLE_SNAPSHOT_H
+#define ODE_EXAMPLE_SNAPSHOT_H
+
+#include "simulation.h"
+
+#include <stdint.h>
+#include <string>
+
+// World snapshots for warm starts. A snapshot holds the dynamic state of every body in sim.Objects, not the scene
+// itself: it is restored on top of a Simulation that was built the same way as the one it was taken from (same
+// InitODE / BuildScene call, so the same bodies in the same order). The file is a header followed by one fixed size
+// record per body. LoadSnapshot maps the file and copies the records straight into the bodies, so restoring a settled
+// pile costs one pass over the bodies instead of simulating the settling again.
+//
+// ODE does not expose a body's running auto disable counters (idle steps / time so far and the velocity averaging
+// buffer), only its auto disable settings. Those settings and the enabled flag are stored; an enabled body starts
+// counting its idle time from zero after a restore. Bodies that were already disabled, which in a settled pile is
+// nearly all of them, stay disabled.
+struct SnapshotBody
+{
+    dReal Position[3];
+    dReal Quaternion[4];
+    dReal LinearVel[3];
+    dReal AngularVel[3];
+    dReal AutoDisableLinearThreshold;
+    dReal AutoDisableAngularThreshold;
+    dReal AutoDisableTime;
+    int32_t AutoDisableSteps;
+    int32_t AutoDisableAverageSamples;
+    uint8_t AutoDisable;
+    uint8_t Enabled;
+    uint8_t Reserved[6];
+};
+
+bool SaveSnapshot(const std::string& path, const Simulation& sim);
+
+// Fails without touching sim if the file does not hold exactly sim.Objects.size() bodies. Also restores
+// sim.StepCount and sim.RestStep.
+bool LoadSnapshot(const std::string& path, Simulation& sim);
+
+#endif
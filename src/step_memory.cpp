@@ -0,0 +1,160 @@
+#include "step_memory.h"
+#include "rewind.h"
+#include "simulation.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace
+{
+
+// The world being stepped on this thread, set by StepMemoryScope
+thread_local Simulation* stepping = 0;
+
+// Every arena starts with the stats it is counted in, so it can be freed from anywhere (CloseODE, another thread).
+// The header keeps the arena as aligned as malloc made it.
+const size_t HEADER_SIZE = 16;
+static_assert(sizeof(StepMemoryStats*) <= HEADER_SIZE, "the arena header has to hold the stats pointer");
+
+StepMemoryStats*& Owner(void* block)
+{
+    return *(StepMemoryStats**)((char*)block - HEADER_SIZE);
+}
+
+void* AllocArena(size_t block_size)
+{
+    char* p = (char*)std::malloc(block_size + HEADER_SIZE);
+    if (!p)
+        return 0;
+
+    StepMemoryStats* stats = stepping ? stepping->MemoryStats : 0;
+    if (stats)
+    {
+        ++stats->Allocations;
+        stats->ArenaBytes += block_size;
+        stats->LargestArena = std::max<uint64_t>(stats->LargestArena, block_size);
+        stats->AllocationSteps.push_back(stepping->StepCount);
+    }
+
+    Owner(p + HEADER_SIZE) = stats;
+    return p + HEADER_SIZE;
+}
+
+void* ShrinkArena(void* block, size_t current_size, size_t smaller_size)
+{
+    // Shrinking in place is allowed to fail, in which case ODE keeps using the block as it is
+    void* p = std::realloc((char*)block - HEADER_SIZE, smaller_size + HEADER_SIZE);
+    if (!p)
+        return block;
+    block = (char*)p + HEADER_SIZE;
+
+    StepMemoryStats* stats = Owner(block);
+    if (stats)
+    {
+        ++stats->Shrinks;
+        stats->ArenaBytes -= current_size - smaller_size;
+    }
+    return block;
+}
+
+void FreeArena(void* block, size_t current_size)
+{
+    StepMemoryStats* stats = Owner(block);
+    if (stats)
+    {
+        ++stats->Frees;
+        stats->ArenaBytes -= current_size;
+    }
+    std::free((char*)block - HEADER_SIZE);
+}
+
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void ApplyStepMemoryConfig(Simulation& sim)
+{
+    dWorldStepReserveInfo reserve;
+    reserve.struct_size = sizeof(reserve);
+    reserve.reserve_factor = sim.StepMemory.ReserveFactor;
+    reserve.reserve_minimum = sim.StepMemory.ReserveMinimum;
+    dWorldSetStepMemoryReservationPolicy(sim.World, &reserve);
+
+    // An arena has to be freed by the functions that allocated it, so the current one goes first. Passing null
+    // restores ODE's own functions.
+    dWorldCleanupWorkingMemory(sim.World);
+    if (sim.StepMemory.Instrument)
+    {
+        dWorldStepMemoryFunctionsInfo functions;
+        functions.struct_size = sizeof(functions);
+        functions.alloc_block = &AllocArena;
+        functions.shrink_block = &ShrinkArena;
+        functions.free_block = &FreeArena;
+        dWorldSetStepMemoryManager(sim.World, &functions);
+    }
+    else
+        dWorldSetStepMemoryManager(sim.World, 0);
+}
+
+void ResetStepMemoryStats(StepMemoryStats& stats)
+{
+    stats.Allocations = 0;
+    stats.Frees = 0;
+    stats.Shrinks = 0;
+    stats.LargestArena = 0;
+    stats.AllocationSteps.clear();
+}
+
+StepMemoryScope::StepMemoryScope(Simulation& sim) : previous_(stepping)
+{
+    stepping = &sim;
+}
+
+StepMemoryScope::~StepMemoryScope()
+{
+    stepping = previous_;
+}
+
+unsigned LearnStepMemory(Simulation& sim, double dt, unsigned warmup_steps, float margin)
+{
+    WorldState start;
+    CaptureWorldState(sim, start);
+
+    // The warmup steps are not part of the run, nothing outside may see them
+    OutputPipeline* output = sim.Output;
+    RewindBuffer* rewind = sim.Rewind;
+    StepProfile* profile = sim.Profile;
+    StepMemoryStats* memory_stats = sim.MemoryStats;
+    sim.Output = 0;
+    sim.Rewind = 0;
+    sim.Profile = 0;
+
+    // Start from an empty arena, otherwise one that is already large enough is never reallocated and the real high
+    // water mark is not seen. Without any reserve on top of what a step needs every growth is visible.
+    StepMemoryConfig config = sim.StepMemory;
+    dWorldCleanupWorkingMemory(sim.World);
+    sim.StepMemory.ReserveFactor = 1.0f;
+    sim.StepMemory.ReserveMinimum = 0;
+    sim.StepMemory.Instrument = true;
+    ApplyStepMemoryConfig(sim);
+
+    StepMemoryStats warmup;
+    sim.MemoryStats = &warmup;
+    for(unsigned i = 0; i < warmup_steps; ++i)
+        SimLoop(sim, dt);
+    uint64_t needed = warmup.LargestArena;
+
+    // The next step allocates a single arena of the learned size. The warmup arenas go before their stats do.
+    dWorldCleanupWorkingMemory(sim.World);
+    sim.MemoryStats = memory_stats;
+    sim.StepMemory = config;
+    sim.StepMemory.ReserveMinimum = std::max<uint64_t>(config.ReserveMinimum, (uint64_t)(needed * margin));
+    ApplyStepMemoryConfig(sim);
+
+    RestoreWorldState(sim, start);
+    sim.Output = output;
+    sim.Rewind = rewind;
+    sim.Profile = profile;
+
+    return sim.StepMemory.ReserveMinimum;
+}
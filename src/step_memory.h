@@ -0,0 +1,75 @@
+#ifndef ODE_EXAMPLE_STEP_MEMORY_H
+#define ODE_EXAMPLE_STEP_MEMORY_H
+
+#define dDOUBLE
+#include <ode/ode.h>
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+struct Simulation;
+
+// dWorldQuickStep does all its temporary allocations from a per-world arena. When a step needs more than the arena
+// holds, ODE frees it and allocates a new one of needed * ReserveFactor bytes, but at least ReserveMinimum. That
+// reallocation happens in the middle of a step, typically when a pile collapses and the islands suddenly get large,
+// and shows up as a latency spike.
+struct StepMemoryConfig
+{
+    float ReserveFactor;      // ODE's default is dWORLDSTEP_RESERVEFACTOR_DEFAULT (1.2)
+    unsigned ReserveMinimum;  // ODE's default is dWORLDSTEP_RESERVESIZE_DEFAULT (64 KiB)
+
+    // Allocate the arenas through counting functions instead of ODE's default ones, see StepMemoryStats
+    bool Instrument;
+
+    StepMemoryConfig() : ReserveFactor(1.2f), ReserveMinimum(65536), Instrument(false) {}
+};
+
+// Arena activity of one world. With StepMemoryConfig::Instrument set, the arenas a world allocates while SimLoop
+// steps it are counted in the stats Simulation::MemoryStats points to at that time. Every arena remembers its stats,
+// so they have to stay around until the world's arenas are gone (CloseODE, dWorldCleanupWorkingMemory). A growing
+// arena shows up as an allocation plus a free.
+struct StepMemoryStats
+{
+    uint64_t Allocations;
+    uint64_t Frees;
+    uint64_t Shrinks;
+    int64_t ArenaBytes;      // current size of the world's arenas together
+    uint64_t LargestArena;   // largest single arena allocated
+
+    // Simulation::StepCount of the step that made each allocation, i.e. the steps that had to reallocate
+    std::vector<uint64_t> AllocationSteps;
+
+    StepMemoryStats() : Allocations(0), Frees(0), Shrinks(0), ArenaBytes(0), LargestArena(0) {}
+};
+
+// Clears the counts. ArenaBytes is a level, not a count, it stays as the arenas are still allocated.
+void ResetStepMemoryStats(StepMemoryStats& stats);
+
+// Applies sim.StepMemory to sim.World. CreateWorld calls this, call it again after changing sim.StepMemory.
+void ApplyStepMemoryConfig(Simulation& sim);
+
+// ODE's memory manager functions get no context, so this tells them which world is being stepped on the current
+// thread. SimLoop puts one around dWorldQuickStep.
+class StepMemoryScope
+{
+public:
+    explicit StepMemoryScope(Simulation& sim);
+    ~StepMemoryScope();
+
+private:
+    StepMemoryScope(const StepMemoryScope&);
+    StepMemoryScope& operator=(const StepMemoryScope&);
+
+    Simulation* previous_;
+};
+
+// Learns the arena size a scene needs: runs warmup_steps steps with the instrumented manager, sets
+// sim.StepMemory.ReserveMinimum to the largest arena seen times margin and drops the current arena, so the next step
+// allocates one arena that is large enough for the rest of the run. The bodies are then put back into the state they
+// had before the warmup (see RestoreWorldState). Returns the new reserve minimum. The learned config can be copied to
+// other worlds running the same scene before their first step. The warmup is counted in stats of its own,
+// sim.MemoryStats only sees the dropped arenas go.
+unsigned LearnStepMemory(Simulation& sim, double dt, unsigned warmup_steps, float margin = 1.25f);
+
+#endif
@@ -0,0 +1,99 @@
+#include "thread_pool.h"
+#include "simulation.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned num_threads)
+    : job_(0), count_(0), grain_(1), next_(0), generation_(0), busy_(0), stop_(false)
+{
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for(unsigned i = 1; i < num_threads; ++i)
+        threads_.push_back(std::thread(&ThreadPool::WorkerMain, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_cv_.notify_all();
+
+    for(size_t i = 0; i < threads_.size(); ++i)
+        threads_[i].join();
+}
+
+void ThreadPool::ParallelFor(size_t count, const Job& job, size_t grain)
+{
+    if (count == 0)
+        return;
+
+    // Not worth waking anybody up for
+    if (threads_.empty() || count <= grain)
+    {
+        for(size_t i = 0; i < count; ++i)
+            job(i, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &job;
+        count_ = count;
+        grain_ = std::max<size_t>(1, grain);
+        next_.store(0, std::memory_order_relaxed);
+        busy_ = (unsigned)threads_.size();
+        ++generation_;
+    }
+    start_cv_.notify_all();
+
+    RunJob(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return busy_ == 0; });
+    job_ = 0;
+}
+
+void ThreadPool::RunJob(unsigned thread)
+{
+    for(;;)
+    {
+        size_t begin = next_.fetch_add(grain_, std::memory_order_relaxed);
+        if (begin >= count_)
+            break;
+
+        size_t end = std::min(count_, begin + grain_);
+        for(size_t i = begin; i < end; ++i)
+            (*job_)(i, thread);
+    }
+}
+
+void ThreadPool::WorkerMain(unsigned thread)
+{
+    // Every thread that calls into ODE needs its own collision data (see dAllocateODEDataForThread in the ODE docs)
+    dAllocateODEDataForThread(dAllocateMaskAll);
+
+    unsigned seen_generation = 0;
+    for(;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_cv_.wait(lock, [&] { return stop_ || generation_ != seen_generation; });
+            if (stop_)
+                break;
+            seen_generation = generation_;
+        }
+
+        RunJob(thread);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--busy_ == 0)
+                done_cv_.notify_one();
+        }
+    }
+
+    dCleanupODEAllDataForThread();
+}
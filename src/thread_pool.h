@@ -0,0 +1,51 @@
+#ifndef ODE_EXAMPLE_THREAD_POOL_H
+#define ODE_EXAMPLE_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads that execute parallel-for style jobs. The calling thread takes part in every job as
+// thread 0, so a pool of N threads starts N - 1 workers. Each worker allocates its own ODE thread data on start up,
+// which is required before a thread may call into the collision library.
+class ThreadPool
+{
+public:
+    typedef std::function<void(size_t index, unsigned thread)> Job;
+
+    // num_threads == 0 uses one thread per hardware core
+    explicit ThreadPool(unsigned num_threads = 0);
+    ~ThreadPool();
+
+    // Total number of threads that execute jobs, including the calling thread
+    unsigned NumThreads() const { return (unsigned)threads_.size() + 1; }
+
+    // Calls job(index, thread) for every index in [0, count) and returns once all of them have finished, which makes
+    // each call a single barrier. Indices are handed out dynamically in chunks of 'grain' so uneven work balances out.
+    void ParallelFor(size_t count, const Job& job, size_t grain = 1);
+
+private:
+    void WorkerMain(unsigned thread);
+    void RunJob(unsigned thread);
+
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+
+    const Job* job_;
+    size_t count_;
+    size_t grain_;
+    std::atomic<size_t> next_;
+
+    unsigned generation_;
+    unsigned busy_;
+    bool stop_;
+};
+
+#endif
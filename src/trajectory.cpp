@@ -0,0 +1,372 @@
+#include "trajectory.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+const char TRAJECTORY_MAGIC[8] = { 'O', 'D', 'E', 'T', 'R', 'A', 'J', '1' };
+const uint32_t TRAJECTORY_VERSION = 1;
+
+// The writer maps PageSize() * CHUNK_PAGES records at a time, which is CHUNK_PAGES * record size pages. A chunk thus
+// always holds a whole number of records and starts at a page aligned offset, so records never straddle two mappings.
+const size_t CHUNK_PAGES = 16;
+
+struct TrajectoryFileHeader
+{
+    char Magic[8];
+    uint32_t Version;
+    uint32_t Fields;
+    uint32_t RecordSize;
+    uint32_t NumBodies;
+    uint64_t DataOffset;  // first record, page aligned
+    uint64_t NumRecords;
+};
+
+// Every record starts with the step index and body id, followed by the selected fields in enum order
+const size_t RECORD_PREFIX_SIZE = sizeof(uint64_t) + 2 * sizeof(uint32_t);
+
+size_t PageSize()
+{
+    long page = sysconf(_SC_PAGESIZE);
+    return page > 0 ? (size_t)page : 4096;
+}
+
+unsigned char* Put(unsigned char* out, const dReal* values, size_t n)
+{
+    for(size_t i = 0; i < n; ++i)
+    {
+        double v = values[i];
+        std::memcpy(out, &v, sizeof(double));
+        out += sizeof(double);
+    }
+    return out;
+}
+
+const unsigned char* Get(const unsigned char* in, dReal* values, size_t n)
+{
+    for(size_t i = 0; i < n; ++i)
+    {
+        double v;
+        std::memcpy(&v, in, sizeof(double));
+        values[i] = v;
+        in += sizeof(double);
+    }
+    return in;
+}
+
+void EncodeRecord(unsigned char* out, unsigned fields, uint64_t step, uint32_t body, const dReal* pos,
+                  const dReal* quat, const dReal* linear_vel, const dReal* angular_vel)
+{
+    uint32_t reserved = 0;
+    std::memcpy(out, &step, sizeof(step));
+    std::memcpy(out + sizeof(step), &body, sizeof(body));
+    std::memcpy(out + sizeof(step) + sizeof(body), &reserved, sizeof(reserved));
+    out += RECORD_PREFIX_SIZE;
+
+    if (fields & TRAJ_POSITION)
+        out = Put(out, pos, 3);
+    if (fields & TRAJ_QUATERNION)
+        out = Put(out, quat, 4);
+    if (fields & TRAJ_LINEAR_VEL)
+        out = Put(out, linear_vel, 3);
+    if (fields & TRAJ_ANGULAR_VEL)
+        out = Put(out, angular_vel, 3);
+}
+
+}
+
+size_t TrajectoryRecordSize(unsigned fields)
+{
+    size_t size = RECORD_PREFIX_SIZE;
+    if (fields & TRAJ_POSITION)
+        size += 3 * sizeof(double);
+    if (fields & TRAJ_QUATERNION)
+        size += 4 * sizeof(double);
+    if (fields & TRAJ_LINEAR_VEL)
+        size += 3 * sizeof(double);
+    if (fields & TRAJ_ANGULAR_VEL)
+        size += 3 * sizeof(double);
+    return size;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+TrajectoryWriter::TrajectoryWriter()
+    : fd_(-1), fields_(0), num_bodies_(0), record_size_(0), chunk_records_(0), num_records_(0), chunk_(0),
+      chunk_index_(0)
+{
+}
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+    Close();
+}
+
+bool TrajectoryWriter::Open(const std::string& path, unsigned fields, unsigned num_bodies)
+{
+    Close();
+
+    if (num_bodies == 0)
+    {
+        std::cerr << "[TrajectoryWriter] Cannot record a world without bodies" << std::endl;
+        return false;
+    }
+
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0)
+    {
+        std::cerr << "[TrajectoryWriter] Could not open '" << path << "': " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    fields_ = fields & TRAJ_ALL;
+    num_bodies_ = num_bodies;
+    record_size_ = TrajectoryRecordSize(fields_);
+    chunk_records_ = PageSize() * CHUNK_PAGES;
+    num_records_ = 0;
+
+    return true;
+}
+
+void TrajectoryWriter::Close()
+{
+    if (fd_ < 0)
+        return;
+
+    UnmapChunk();
+
+    // Cut off the unused tail of the last chunk and only then write the header, so a file with a valid record count
+    // never claims more records than it holds
+    TrajectoryFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.Magic, TRAJECTORY_MAGIC, sizeof(header.Magic));
+    header.Version = TRAJECTORY_VERSION;
+    header.Fields = fields_;
+    header.RecordSize = (uint32_t)record_size_;
+    header.NumBodies = num_bodies_;
+    header.DataOffset = PageSize();
+    header.NumRecords = num_records_;
+
+    if (ftruncate(fd_, header.DataOffset + num_records_ * record_size_) != 0
+            || pwrite(fd_, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+        std::cerr << "[TrajectoryWriter] Could not finalize file: " << std::strerror(errno) << std::endl;
+
+    close(fd_);
+    fd_ = -1;
+}
+
+bool TrajectoryWriter::MapChunk(uint64_t chunk)
+{
+    UnmapChunk();
+
+    size_t chunk_bytes = chunk_records_ * record_size_;
+    off_t offset = PageSize() + chunk * chunk_bytes;
+
+    if (ftruncate(fd_, offset + chunk_bytes) != 0)
+    {
+        std::cerr << "[TrajectoryWriter] Could not grow file: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    void* p = mmap(0, chunk_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, offset);
+    if (p == MAP_FAILED)
+    {
+        std::cerr << "[TrajectoryWriter] Could not map chunk: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    chunk_ = static_cast<unsigned char*>(p);
+    chunk_index_ = chunk;
+    return true;
+}
+
+void TrajectoryWriter::UnmapChunk()
+{
+    if (!chunk_)
+        return;
+
+    munmap(chunk_, chunk_records_ * record_size_);
+    chunk_ = 0;
+}
+
+unsigned char* TrajectoryWriter::NextRecord()
+{
+    uint64_t chunk = num_records_ / chunk_records_;
+    if (!chunk_ || chunk != chunk_index_)
+    {
+        if (!MapChunk(chunk))
+            return 0;
+    }
+
+    return chunk_ + (num_records_++ % chunk_records_) * record_size_;
+}
+
+bool TrajectoryWriter::Record(uint64_t step, const Simulation& sim)
+{
+    if (fd_ < 0 || sim.Objects.size() != num_bodies_)
+        return false;
+
+    for(uint32_t i = 0; i < num_bodies_; ++i)
+    {
+        unsigned char* out = NextRecord();
+        if (!out)
+            return false;
+
+        dBodyID body = sim.Objects[i].Body;
+        EncodeRecord(out, fields_, step, i, dBodyGetPosition(body), dBodyGetQuaternion(body),
+                     dBodyGetLinearVel(body), dBodyGetAngularVel(body));
+    }
+
+    return true;
+}
+
+bool TrajectoryWriter::Record(const TrajectorySample* samples, unsigned num_samples)
+{
+    if (fd_ < 0 || num_samples != num_bodies_)
+        return false;
+
+    for(unsigned i = 0; i < num_samples; ++i)
+    {
+        unsigned char* out = NextRecord();
+        if (!out)
+            return false;
+
+        const TrajectorySample& s = samples[i];
+        EncodeRecord(out, fields_, s.Step, s.Body, s.Position, s.Quaternion, s.LinearVel, s.AngularVel);
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+TrajectoryReader::TrajectoryReader()
+    : fd_(-1), data_(0), size_(0), data_offset_(0), fields_(0), num_bodies_(0), record_size_(0), num_records_(0)
+{
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+    Close();
+}
+
+bool TrajectoryReader::Open(const std::string& path)
+{
+    Close();
+
+    fd_ = open(path.c_str(), O_RDONLY);
+    if (fd_ < 0)
+    {
+        std::cerr << "[TrajectoryReader] Could not open '" << path << "': " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || (size_t)st.st_size < sizeof(TrajectoryFileHeader))
+    {
+        std::cerr << "[TrajectoryReader] '" << path << "' is not a trajectory file" << std::endl;
+        Close();
+        return false;
+    }
+
+    size_ = st.st_size;
+    void* p = mmap(0, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED)
+    {
+        std::cerr << "[TrajectoryReader] Could not map '" << path << "': " << std::strerror(errno) << std::endl;
+        size_ = 0;
+        Close();
+        return false;
+    }
+    data_ = static_cast<const unsigned char*>(p);
+
+    TrajectoryFileHeader header;
+    std::memcpy(&header, data_, sizeof(header));
+
+    if (std::memcmp(header.Magic, TRAJECTORY_MAGIC, sizeof(header.Magic)) != 0
+            || header.Version != TRAJECTORY_VERSION
+            || header.NumBodies == 0
+            || header.RecordSize != TrajectoryRecordSize(header.Fields)
+            || header.DataOffset + header.NumRecords * header.RecordSize > size_)
+    {
+        std::cerr << "[TrajectoryReader] '" << path << "' is not a valid trajectory file" << std::endl;
+        Close();
+        return false;
+    }
+
+    fields_ = header.Fields;
+    num_bodies_ = header.NumBodies;
+    record_size_ = header.RecordSize;
+    num_records_ = header.NumRecords;
+    data_offset_ = header.DataOffset;
+
+    return true;
+}
+
+void TrajectoryReader::Close()
+{
+    if (data_)
+        munmap(const_cast<unsigned char*>(data_), size_);
+    if (fd_ >= 0)
+        close(fd_);
+
+    fd_ = -1;
+    data_ = 0;
+    size_ = 0;
+    num_records_ = 0;
+}
+
+uint64_t TrajectoryReader::FrameStep(uint64_t frame) const
+{
+    uint64_t step;
+    std::memcpy(&step, data_ + data_offset_ + frame * num_bodies_ * record_size_, sizeof(step));
+    return step;
+}
+
+uint64_t TrajectoryReader::FindStep(uint64_t step) const
+{
+    // Frames are written in increasing step order, but not necessarily for every step
+    uint64_t lo = 0;
+    uint64_t hi = NumFrames();
+    while (lo < hi)
+    {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (FrameStep(mid) < step)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+bool TrajectoryReader::Read(uint64_t frame, unsigned body, TrajectorySample& sample) const
+{
+    if (frame >= NumFrames() || body >= num_bodies_)
+        return false;
+
+    std::memset(&sample, 0, sizeof(sample));
+
+    const unsigned char* in = data_ + data_offset_ + (frame * num_bodies_ + body) * record_size_;
+    std::memcpy(&sample.Step, in, sizeof(sample.Step));
+    std::memcpy(&sample.Body, in + sizeof(sample.Step), sizeof(sample.Body));
+    in += RECORD_PREFIX_SIZE;
+
+    if (fields_ & TRAJ_POSITION)
+        in = Get(in, sample.Position, 3);
+    if (fields_ & TRAJ_QUATERNION)
+        in = Get(in, sample.Quaternion, 4);
+    if (fields_ & TRAJ_LINEAR_VEL)
+        in = Get(in, sample.LinearVel, 3);
+    if (fields_ & TRAJ_ANGULAR_VEL)
+        in = Get(in, sample.AngularVel, 3);
+
+    return true;
+}
@@ -0,0 +1,117 @@
+#ifndef ODE_EXAMPLE_TRAJECTORY_H
+#define ODE_EXAMPLE_TRAJECTORY_H
+
+#include "simulation.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+
+// Binary trajectory files. A file is a one page header followed by fixed size records, one record per body per
+// recorded step. The records of one step (a frame) are stored back to back in body order, so the position of any
+// frame in the file is known without looking at the data before it. Which of the state fields are stored is chosen
+// when the file is created; the step index and body id are always present.
+
+enum TrajectoryField
+{
+    TRAJ_POSITION    = 1 << 0,
+    TRAJ_QUATERNION  = 1 << 1,
+    TRAJ_LINEAR_VEL  = 1 << 2,
+    TRAJ_ANGULAR_VEL = 1 << 3,
+
+    TRAJ_ALL = TRAJ_POSITION | TRAJ_QUATERNION | TRAJ_LINEAR_VEL | TRAJ_ANGULAR_VEL
+};
+
+// One decoded record. Fields that were not recorded are left at zero.
+struct TrajectorySample
+{
+    uint64_t Step;
+    uint32_t Body;
+    dReal Position[3];
+    dReal Quaternion[4];
+    dReal LinearVel[3];
+    dReal AngularVel[3];
+};
+
+// Size in bytes of a single record for the given field mask
+size_t TrajectoryRecordSize(unsigned fields);
+
+// Writes records through a memory mapping of the file. The file is grown and mapped one chunk at a time, so memory
+// use does not depend on the length of the run and writing a record is a plain memcpy.
+class TrajectoryWriter
+{
+public:
+    TrajectoryWriter();
+    ~TrajectoryWriter();
+
+    bool Open(const std::string& path, unsigned fields, unsigned num_bodies);
+    void Close();
+    bool IsOpen() const { return fd_ >= 0; }
+
+    // Appends one frame holding the state of every object in sim.Objects
+    bool Record(uint64_t step, const Simulation& sim);
+
+    // Appends one frame from already extracted body states, samples[i].Body must be i
+    bool Record(const TrajectorySample* samples, unsigned num_samples);
+
+    uint64_t NumFrames() const { return num_bodies_ ? num_records_ / num_bodies_ : 0; }
+
+private:
+    TrajectoryWriter(const TrajectoryWriter&);
+    TrajectoryWriter& operator=(const TrajectoryWriter&);
+
+    unsigned char* NextRecord();
+    bool MapChunk(uint64_t chunk);
+    void UnmapChunk();
+
+    int fd_;
+    unsigned fields_;
+    unsigned num_bodies_;
+    size_t record_size_;
+    size_t chunk_records_;
+
+    uint64_t num_records_;
+
+    unsigned char* chunk_;
+    uint64_t chunk_index_;
+};
+
+// Maps a whole trajectory file read-only. Seeking to a step is a binary search over frame starts, nothing before the
+// requested frame is parsed.
+class TrajectoryReader
+{
+public:
+    TrajectoryReader();
+    ~TrajectoryReader();
+
+    bool Open(const std::string& path);
+    void Close();
+
+    unsigned Fields() const { return fields_; }
+    unsigned NumBodies() const { return num_bodies_; }
+    uint64_t NumFrames() const { return num_bodies_ ? num_records_ / num_bodies_ : 0; }
+
+    // Index of the first frame whose step is >= step, or NumFrames() if there is none
+    uint64_t FindStep(uint64_t step) const;
+
+    // Decodes the record of 'body' in 'frame'
+    bool Read(uint64_t frame, unsigned body, TrajectorySample& sample) const;
+
+private:
+    TrajectoryReader(const TrajectoryReader&);
+    TrajectoryReader& operator=(const TrajectoryReader&);
+
+    uint64_t FrameStep(uint64_t frame) const;
+
+    int fd_;
+    const unsigned char* data_;
+    size_t size_;
+    uint64_t data_offset_;
+
+    unsigned fields_;
+    unsigned num_bodies_;
+    size_t record_size_;
+    uint64_t num_records_;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include "vector_env.h"
+#include "world_pool.h"
+
+#include <cmath>
+
+VectorEnv::VectorEnv(const VectorEnvConfig& config)
+    : config_(config), worlds_(config.NumWorlds), initial_(config.NumWorlds),
+      observations_(config.NumWorlds * OBSERVATION_SIZE), rewards_(config.NumWorlds), dones_(config.NumWorlds),
+      episode_steps_(config.NumWorlds), pool_(config.NumThreads), actions_(0)
+{
+    pool_.ParallelFor(worlds_.size(), [this](size_t i, unsigned)
+    {
+        worlds_[i].Random = RandomStream(config_.RunId, i);
+        InitODE(worlds_[i]);
+        CaptureWorldState(worlds_[i], initial_[i]);
+    });
+
+    step_job_ = [this](size_t i, unsigned) { StepWorld(i); };
+    reset_job_ = [this](size_t i, unsigned) { ResetWorld(i); };
+}
+
+VectorEnv::~VectorEnv()
+{
+    for(size_t i = 0; i < worlds_.size(); ++i)
+        CloseODE(worlds_[i]);
+}
+
+void VectorEnv::Reset()
+{
+    pool_.ParallelFor(worlds_.size(), reset_job_, 16);
+}
+
+void VectorEnv::Step(const float* actions)
+{
+    actions_ = actions;
+    pool_.ParallelFor(worlds_.size(), step_job_, 16);
+    actions_ = 0;
+}
+
+void VectorEnv::StepWorld(size_t i)
+{
+    Simulation& sim = worlds_[i];
+    dBodyID box = sim.Objects[0].Body;
+
+    const float* a = actions_ + i * ACTION_SIZE;
+    if (a[0] != 0 || a[1] != 0 || a[2] != 0)
+    {
+        // A sleeping body ignores forces, and a world with input is never at rest
+        dBodyEnable(box);
+        dBodyAddForce(box, a[0] * config_.ForceScale, a[1] * config_.ForceScale, a[2] * config_.ForceScale);
+        sim.InputPending = true;
+    }
+
+    SimLoop(sim, config_.TimeStep);
+    ++episode_steps_[i];
+
+    const dReal* p = dBodyGetPosition(box);
+    const dReal* p0 = &initial_[i].Position[0];
+    rewards_[i] = -(float)std::sqrt((p[0] - p0[0]) * (p[0] - p0[0]) + (p[2] - p0[2]) * (p[2] - p0[2]));
+
+    dones_[i] = episode_steps_[i] >= config_.MaxEpisodeSteps || AtRest(sim);
+
+    if (dones_[i])
+        ResetWorld(i);
+    else
+        Observe(i);
+}
+
+void VectorEnv::ResetWorld(size_t i)
+{
+    ResetWorldInPlace(worlds_[i], initial_[i]);
+    episode_steps_[i] = 0;
+    Observe(i);
+}
+
+void VectorEnv::Observe(size_t i)
+{
+    dBodyID box = worlds_[i].Objects[0].Body;
+    float* o = &observations_[i * OBSERVATION_SIZE];
+
+    const dReal* p = dBodyGetPosition(box);
+    const dReal* q = dBodyGetQuaternion(box);
+    const dReal* v = dBodyGetLinearVel(box);
+    const dReal* w = dBodyGetAngularVel(box);
+    for(int k = 0; k < 3; ++k)
+    {
+        o[k] = (float)p[k];
+        o[7 + k] = (float)v[k];
+        o[10 + k] = (float)w[k];
+    }
+    for(int k = 0; k < 4; ++k)
+        o[3 + k] = (float)q[k];
+}
@@ -0,0 +1,87 @@
+#ifndef ODE_EXAMPLE_VECTOR_ENV_H
+#define ODE_EXAMPLE_VECTOR_ENV_H
+
+#include "rewind.h"
+#include "simulation.h"
+#include "thread_pool.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+struct VectorEnvConfig
+{
+    size_t NumWorlds;
+    unsigned NumThreads;       // 0 uses one thread per hardware core
+    double TimeStep;
+    uint32_t MaxEpisodeSteps;  // an episode also ends when its world comes to rest
+    dReal ForceScale;          // an action of 1 is a force of this many Newtons
+    uint64_t RunId;            // world i is built with RandomStream(RunId, i)
+
+    VectorEnvConfig() : NumWorlds(1), NumThreads(0), TimeStep(0.01), MaxEpisodeSteps(1000), ForceScale(10),
+                        RunId(0) {}
+};
+
+// Many copies of the example scene driven as one environment for a learning loop. Step takes one action per world,
+// steps all worlds in parallel and writes observations, rewards and done flags into buffers that are allocated once,
+// in the constructor. A world whose episode ended is reset in place during the same Step: its bodies are put back
+// into the state InitODE left them in (see ResetWorldInPlace), its ODE objects are kept.
+//
+// The task of the example: the action is a force (x, y, z) applied to the box's center of mass, the observation is
+// the box's position, quaternion (w x y z), linear and angular velocity, and the reward is minus the horizontal
+// distance of the box from where it was dropped.
+class VectorEnv
+{
+public:
+    static const int OBSERVATION_SIZE = 13;
+    static const int ACTION_SIZE = 3;
+
+    explicit VectorEnv(const VectorEnvConfig& config);
+    ~VectorEnv();
+
+    // Resets every world and writes the first observations
+    void Reset();
+
+    // actions holds ACTION_SIZE values per world, world after world. Afterwards Observations() holds the state after
+    // the step, or, for worlds that are done, the first observation of their next episode.
+    void Step(const float* actions);
+
+    // NumWorlds() x OBSERVATION_SIZE, world after world
+    const float* Observations() const { return &observations_[0]; }
+    const float* Rewards() const { return &rewards_[0]; }
+    const uint8_t* Dones() const { return &dones_[0]; }
+
+    // Number of steps of the episode each world is in, 0 right after a reset
+    const uint32_t* EpisodeSteps() const { return &episode_steps_[0]; }
+
+    size_t NumWorlds() const { return worlds_.size(); }
+    Simulation& World(size_t i) { return worlds_[i]; }
+    ThreadPool& Pool() { return pool_; }
+
+private:
+    VectorEnv(const VectorEnv&);
+    VectorEnv& operator=(const VectorEnv&);
+
+    void StepWorld(size_t i);
+    void ResetWorld(size_t i);
+    void Observe(size_t i);
+
+    VectorEnvConfig config_;
+
+    std::vector<Simulation> worlds_;
+    std::vector<WorldState> initial_;  // state of each world right after InitODE
+
+    std::vector<float> observations_;
+    std::vector<float> rewards_;
+    std::vector<uint8_t> dones_;
+    std::vector<uint32_t> episode_steps_;
+
+    ThreadPool pool_;
+
+    // Built once, so handing the jobs to the pool does not allocate
+    const float* actions_;
+    ThreadPool::Job step_job_;
+    ThreadPool::Job reset_job_;
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include "world_pool.h"
+
+#include <cassert>
+#include <iostream>
+
+void ResetWorldInPlace(Simulation& sim, const WorldState& initial)
+{
+    // Normally already empty after SimLoop, but an episode may end in the middle of a step
+    dJointGroupEmpty(sim.contactgroup);
+
+    RestoreWorldState(sim, initial);
+
+    for(size_t i = 0; i < sim.Objects.size(); ++i)
+    {
+        dBodySetForce(sim.Objects[i].Body, 0, 0, 0);
+        dBodySetTorque(sim.Objects[i].Body, 0, 0, 0);
+    }
+
+    sim.InputPending = false;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+WorldPool::WorldPool(size_t size, const Builder& build, uint64_t run_id)
+    : build_(build ? build : Builder([](Simulation& sim) { InitODE(sim); })), run_id_(run_id), num_built_(size)
+{
+    worlds_.reserve(size);
+    free_.reserve(size);
+    for(size_t i = 0; i < size; ++i)
+    {
+        Entry* entry = Build(i);
+        worlds_.push_back(entry);
+        free_.push_back(entry);
+    }
+}
+
+WorldPool::~WorldPool()
+{
+    for(size_t i = 0; i < worlds_.size(); ++i)
+    {
+        CloseODE(worlds_[i]->World);
+        delete worlds_[i];
+    }
+}
+
+WorldPool::Entry* WorldPool::Build(uint64_t index)
+{
+    Entry* entry = new Entry();
+    entry->World.Random = RandomStream(run_id_, index);
+    build_(entry->World);
+    CaptureWorldState(entry->World, entry->Initial);
+    return entry;
+}
+
+Simulation* WorldPool::Acquire()
+{
+    uint64_t index;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_.empty())
+        {
+            Entry* entry = free_.back();
+            free_.pop_back();
+            return &entry->World;
+        }
+        index = num_built_++;
+    }
+
+    // Outside the lock, a world build must not hold up the threads that only acquire and release
+    Entry* entry = Build(index);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    worlds_.push_back(entry);
+    return &entry->World;
+}
+
+void WorldPool::Release(Simulation* sim)
+{
+    // World is the first member, but look the entry up instead of relying on the layout. The pool is small compared
+    // to the work of an episode.
+    Entry* entry = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(size_t i = 0; i < worlds_.size() && !entry; ++i)
+        {
+            if (&worlds_[i]->World == sim)
+                entry = worlds_[i];
+        }
+    }
+    assert(entry && "WorldPool::Release of a world that did not come from this pool");
+    if (!entry)
+    {
+        std::cerr << "[WorldPool::Release] The world did not come from this pool" << std::endl;
+        return;
+    }
+
+    // Outside the lock, other threads can acquire and release while this one copies state
+    ResetWorldInPlace(entry->World, entry->Initial);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(entry);
+}
+
+size_t WorldPool::Size()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return worlds_.size();
+}
+
+size_t WorldPool::Available()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return free_.size();
+}
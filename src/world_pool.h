@@ -0,0 +1,65 @@
+#ifndef ODE_EXAMPLE_WORLD_POOL_H
+#define ODE_EXAMPLE_WORLD_POOL_H
+
+#include "rewind.h"
+#include "simulation.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Puts a world back into a state captured from it earlier, for starting a new episode without building the world
+// again. On top of RestoreWorldState this drops leftover contact joints, clears the force and torque accumulators
+// and anything pending from outside, so the next step behaves as the first step after the capture did. Bodies,
+// geoms, spaces and the joint group are kept as they are, so only the state copy is paid for. Bodies or geoms that
+// were added after the capture are not removed.
+void ResetWorldInPlace(Simulation& sim, const WorldState& initial);
+
+// A set of worlds built up front and handed out one episode at a time. Release resets the world in place to the
+// state it had right after it was built, so it is ready for the next Acquire and episode turnover costs a state copy
+// instead of CloseODE plus another InitODE. Acquire and Release may be called from several threads.
+class WorldPool
+{
+public:
+    typedef std::function<void(Simulation&)> Builder;
+
+    // Builds 'size' worlds with build (InitODE if not given) on the calling thread. The n-th world built gets
+    // RandomStream(run_id, n) before build is called.
+    explicit WorldPool(size_t size, const Builder& build = Builder(), uint64_t run_id = 0);
+    ~WorldPool();
+
+    // A world in its initial state. If all worlds are in use another one is built, which is as slow as it always was;
+    // size the pool for the number of episodes that run at the same time. The build runs on the calling thread
+    // without holding the pool, so several threads that find the pool empty call the builder at the same time.
+    Simulation* Acquire();
+
+    // Resets the world and makes it available again. It must have come from Acquire of this pool, anything else is a
+    // bug that asserts (and is reported and ignored without assertions).
+    void Release(Simulation* sim);
+
+    size_t Size();
+    size_t Available();
+
+private:
+    WorldPool(const WorldPool&);
+    WorldPool& operator=(const WorldPool&);
+
+    struct Entry
+    {
+        Simulation World;
+        WorldState Initial;
+    };
+
+    Entry* Build(uint64_t index);
+
+    Builder build_;
+    uint64_t run_id_;
+    uint64_t num_built_;          // worlds built or being built, the stream index of the next one
+    std::vector<Entry*> worlds_;  // pointers so handed out worlds never move when the pool grows
+    std::vector<Entry*> free_;
+    std::mutex mutex_;
+};
+
+#endif
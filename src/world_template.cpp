@@ -0,0 +1,227 @@
+#include "world_template.h"
+#include "thread_pool.h"
+
+#include <cstring>
+#include <iostream>
+
+WorldTemplate::WorldTemplate(const Simulation& source)
+{
+    dWorldID world = source.World;
+    dWorldGetGravity(world, gravity_);
+    erp_ = dWorldGetERP(world);
+    cfm_ = dWorldGetCFM(world);
+    max_correcting_vel_ = dWorldGetContactMaxCorrectingVel(world);
+    surface_layer_ = dWorldGetContactSurfaceLayer(world);
+    quickstep_iterations_ = dWorldGetQuickStepNumIterations(world);
+    auto_disable_ = dWorldGetAutoDisableFlag(world);
+    auto_disable_linear_ = dWorldGetAutoDisableLinearThreshold(world);
+    auto_disable_angular_ = dWorldGetAutoDisableAngularThreshold(world);
+    auto_disable_steps_ = dWorldGetAutoDisableSteps(world);
+    auto_disable_time_ = dWorldGetAutoDisableTime(world);
+    auto_disable_samples_ = dWorldGetAutoDisableAverageSamplesCount(world);
+
+    materials_ = source.Materials;
+    step_memory_ = source.StepMemory;
+    broadphase_ = source.Broadphase;
+
+    std::memset(hash_levels_, 0, sizeof(hash_levels_));
+    if (broadphase_.Type == BROADPHASE_HASH)
+    {
+        dHashSpaceGetLevels(source.Space, &hash_levels_[0][0], &hash_levels_[0][1]);
+        dHashSpaceGetLevels(source.StaticSpace, &hash_levels_[1][0], &hash_levels_[1][1]);
+    }
+
+    bodies_.resize(source.Objects.size());
+    for(size_t i = 0; i < source.Objects.size(); ++i)
+    {
+        dBodyID body = source.Objects[i].Body;
+        BodyInfo& b = bodies_[i];
+
+        dBodyGetMass(body, &b.Mass);
+        std::memcpy(b.Position, dBodyGetPosition(body), sizeof(b.Position));
+        std::memcpy(b.Quaternion, dBodyGetQuaternion(body), sizeof(b.Quaternion));
+        std::memcpy(b.LinearVel, dBodyGetLinearVel(body), sizeof(b.LinearVel));
+        std::memcpy(b.AngularVel, dBodyGetAngularVel(body), sizeof(b.AngularVel));
+        b.Enabled = dBodyIsEnabled(body) != 0;
+        b.GravityMode = dBodyGetGravityMode(body);
+        b.AutoDisable = dBodyGetAutoDisableFlag(body);
+        b.AutoDisableLinearThreshold = dBodyGetAutoDisableLinearThreshold(body);
+        b.AutoDisableAngularThreshold = dBodyGetAutoDisableAngularThreshold(body);
+        b.AutoDisableSteps = dBodyGetAutoDisableSteps(body);
+        b.AutoDisableTime = dBodyGetAutoDisableTime(body);
+        b.AutoDisableAverageSamples = dBodyGetAutoDisableAverageSamplesCount(body);
+
+        b.FirstGeom = body_geoms_.size();
+        for(dGeomID geom = dBodyGetFirstGeom(body); geom; geom = dBodyGetNextGeom(geom))
+        {
+            GeomInfo info;
+            if (CaptureGeom(geom, true, info))
+                body_geoms_.push_back(info);
+        }
+        b.NumGeoms = body_geoms_.size() - b.FirstGeom;
+    }
+
+    int num_static = dSpaceGetNumGeoms(source.StaticSpace);
+    for(int i = 0; i < num_static; ++i)
+    {
+        GeomInfo info;
+        if (CaptureGeom(dSpaceGetGeom(source.StaticSpace, i), false, info))
+            static_geoms_.push_back(info);
+    }
+}
+
+bool WorldTemplate::CaptureGeom(dGeomID geom, bool body_geom, GeomInfo& info)
+{
+    std::memset(&info, 0, sizeof(info));
+    info.Class = dGeomGetClass(geom);
+    info.Material = GetGeomMaterial(geom);
+    info.CategoryBits = dGeomGetCategoryBits(geom);
+    info.CollideBits = dGeomGetCollideBits(geom);
+
+    switch (info.Class)
+    {
+    case dSphereClass:
+        info.Params[0] = dGeomSphereGetRadius(geom);
+        break;
+    case dBoxClass:
+        dGeomBoxGetLengths(geom, info.Params);
+        break;
+    case dCapsuleClass:
+        dGeomCapsuleGetParams(geom, &info.Params[0], &info.Params[1]);
+        break;
+    case dCylinderClass:
+        dGeomCylinderGetParams(geom, &info.Params[0], &info.Params[1]);
+        break;
+    case dPlaneClass:
+        dGeomPlaneGetParams(geom, info.Params);
+        return true;  // not placeable
+    case dTriMeshClass:
+        info.TriMesh = dGeomTriMeshGetTriMeshDataID(geom);
+        break;
+    default:
+        std::cerr << "[WorldTemplate] Geom class " << info.Class << " is not supported, skipped" << std::endl;
+        return false;
+    }
+
+    // A body geom without an offset simply follows its body
+    if (body_geom && !dGeomIsOffset(geom))
+        return true;
+
+    info.HasPose = true;
+    const dReal* p = body_geom ? dGeomGetOffsetPosition(geom) : dGeomGetPosition(geom);
+    const dReal* R = body_geom ? dGeomGetOffsetRotation(geom) : dGeomGetRotation(geom);
+    std::memcpy(info.Position, p, sizeof(info.Position));
+    std::memcpy(info.Rotation, R, sizeof(info.Rotation));
+    return true;
+}
+
+dGeomID WorldTemplate::CreateGeom(dSpaceID space, const GeomInfo& info)
+{
+    const dReal* p = info.Params;
+    dGeomID geom;
+    switch (info.Class)
+    {
+    case dSphereClass: geom = dCreateSphere(space, p[0]); break;
+    case dBoxClass: geom = dCreateBox(space, p[0], p[1], p[2]); break;
+    case dCapsuleClass: geom = dCreateCapsule(space, p[0], p[1]); break;
+    case dCylinderClass: geom = dCreateCylinder(space, p[0], p[1]); break;
+    case dPlaneClass: geom = dCreatePlane(space, p[0], p[1], p[2], p[3]); break;
+    default: geom = dCreateTriMesh(space, info.TriMesh, 0, 0, 0); break;
+    }
+
+    SetGeomMaterial(geom, info.Material);
+    dGeomSetCategoryBits(geom, info.CategoryBits);
+    dGeomSetCollideBits(geom, info.CollideBits);
+    return geom;
+}
+
+void WorldTemplate::Instantiate(Simulation& clone) const
+{
+    clone.Materials = materials_;
+    clone.StepMemory = step_memory_;
+    CreateWorld(clone, broadphase_);
+
+    dWorldID world = clone.World;
+    dWorldSetGravity(world, gravity_[0], gravity_[1], gravity_[2]);
+    dWorldSetERP(world, erp_);
+    dWorldSetCFM(world, cfm_);
+    dWorldSetContactMaxCorrectingVel(world, max_correcting_vel_);
+    dWorldSetContactSurfaceLayer(world, surface_layer_);
+    dWorldSetQuickStepNumIterations(world, quickstep_iterations_);
+    dWorldSetAutoDisableFlag(world, auto_disable_);
+    dWorldSetAutoDisableLinearThreshold(world, auto_disable_linear_);
+    dWorldSetAutoDisableAngularThreshold(world, auto_disable_angular_);
+    dWorldSetAutoDisableSteps(world, auto_disable_steps_);
+    dWorldSetAutoDisableTime(world, auto_disable_time_);
+    dWorldSetAutoDisableAverageSamplesCount(world, auto_disable_samples_);
+
+    // The levels TuneSpaces picked for the source, instead of tuning again
+    if (broadphase_.Type == BROADPHASE_HASH)
+    {
+        dHashSpaceSetLevels(clone.Space, hash_levels_[0][0], hash_levels_[0][1]);
+        dHashSpaceSetLevels(clone.StaticSpace, hash_levels_[1][0], hash_levels_[1][1]);
+    }
+
+    for(size_t i = 0; i < static_geoms_.size(); ++i)
+    {
+        const GeomInfo& info = static_geoms_[i];
+        dGeomID geom = CreateGeom(clone.StaticSpace, info);
+        if (info.HasPose)
+        {
+            dGeomSetPosition(geom, info.Position[0], info.Position[1], info.Position[2]);
+            dGeomSetRotation(geom, info.Rotation);
+        }
+    }
+
+    clone.Objects.resize(bodies_.size());
+    for(size_t i = 0; i < bodies_.size(); ++i)
+    {
+        const BodyInfo& b = bodies_[i];
+        MyObject& object = clone.Objects[i];
+
+        object.Body = dBodyCreate(world);
+        dBodySetMass(object.Body, &b.Mass);
+        dBodySetPosition(object.Body, b.Position[0], b.Position[1], b.Position[2]);
+        dBodySetQuaternion(object.Body, b.Quaternion);
+        dBodySetLinearVel(object.Body, b.LinearVel[0], b.LinearVel[1], b.LinearVel[2]);
+        dBodySetAngularVel(object.Body, b.AngularVel[0], b.AngularVel[1], b.AngularVel[2]);
+        dBodySetGravityMode(object.Body, b.GravityMode);
+        dBodySetAutoDisableFlag(object.Body, b.AutoDisable);
+        dBodySetAutoDisableLinearThreshold(object.Body, b.AutoDisableLinearThreshold);
+        dBodySetAutoDisableAngularThreshold(object.Body, b.AutoDisableAngularThreshold);
+        dBodySetAutoDisableSteps(object.Body, b.AutoDisableSteps);
+        dBodySetAutoDisableTime(object.Body, b.AutoDisableTime);
+        dBodySetAutoDisableAverageSamplesCount(object.Body, b.AutoDisableAverageSamples);
+        dBodySetData(object.Body, (void*)i);
+
+        for(size_t k = 0; k < GEOMSPERBODY; ++k)
+            object.Geom[k] = 0;
+
+        for(size_t k = 0; k < b.NumGeoms; ++k)
+        {
+            const GeomInfo& info = body_geoms_[b.FirstGeom + k];
+            dGeomID geom = CreateGeom(clone.Space, info);
+            dGeomSetBody(geom, object.Body);
+            if (info.HasPose)
+            {
+                dGeomSetOffsetPosition(geom, info.Position[0], info.Position[1], info.Position[2]);
+                dGeomSetOffsetRotation(geom, info.Rotation);
+            }
+            if (k < GEOMSPERBODY)
+                object.Geom[k] = geom;
+        }
+
+        if (!b.Enabled)
+            dBodyDisable(object.Body);
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void CloneWorlds(const WorldTemplate& source, std::vector<Simulation>& worlds, ThreadPool& pool)
+{
+    pool.ParallelFor(worlds.size(), [&source, &worlds](size_t i, unsigned)
+    {
+        source.Instantiate(worlds[i]);
+    });
+}
@@ -0,0 +1,95 @@
+#ifndef ODE_EXAMPLE_WORLD_TEMPLATE_H
+#define ODE_EXAMPLE_WORLD_TEMPLATE_H
+
+#include "simulation.h"
+
+#include <vector>
+
+class ThreadPool;
+
+// A built world reduced to what is needed to build it again: world and solver settings, materials, the broadphase
+// with its tuned hash levels, every body with its final mass properties, and the shape parameters of every geom.
+// Building a clone from it is only the ODE create calls, nothing is computed again: no scene parsing, no mass
+// integration, no random draws and no broadphase tuning.
+//
+// ODE objects can not be shared between worlds, so every clone gets its own bodies and geoms. What is shared is the
+// template itself, which is immutable once captured and can be read by several threads cloning at once, and triangle
+// mesh data: trimesh geoms of all clones reference the dTriMeshDataID of the source world, which therefore has to
+// outlive the clones. Supported geoms are spheres, boxes, capsules, cylinders, planes and triangle meshes, with or
+// without an offset; joints other than the contact joints SimLoop creates are not copied.
+class WorldTemplate
+{
+public:
+    // Captures 'source', which is not modified and may be closed afterwards (unless it owns trimesh data)
+    explicit WorldTemplate(const Simulation& source);
+
+    // Builds a copy into an empty Simulation, which is then in the same state the source was in when it was captured
+    void Instantiate(Simulation& clone) const;
+
+    size_t NumBodies() const { return bodies_.size(); }
+
+private:
+    struct GeomInfo
+    {
+        int Class;
+        dReal Params[4];  // box lengths, sphere radius, capsule / cylinder radius and length, or plane a b c d
+        dTriMeshDataID TriMesh;
+        MaterialID Material;
+        unsigned long CategoryBits;
+        unsigned long CollideBits;
+        bool HasPose;     // position and rotation, or the offset from the body for body geoms
+        dReal Position[3];
+        dMatrix3 Rotation;
+    };
+
+    struct BodyInfo
+    {
+        dMass Mass;
+        dReal Position[3];
+        dQuaternion Quaternion;
+        dReal LinearVel[3];
+        dReal AngularVel[3];
+        bool Enabled;
+        int GravityMode;
+        int AutoDisable;
+        dReal AutoDisableLinearThreshold;
+        dReal AutoDisableAngularThreshold;
+        int AutoDisableSteps;
+        dReal AutoDisableTime;
+        int AutoDisableAverageSamples;
+        size_t FirstGeom;
+        size_t NumGeoms;
+    };
+
+    static bool CaptureGeom(dGeomID geom, bool body_geom, GeomInfo& info);
+    static dGeomID CreateGeom(dSpaceID space, const GeomInfo& info);
+
+    // World settings
+    dVector3 gravity_;
+    dReal erp_;
+    dReal cfm_;
+    dReal max_correcting_vel_;
+    dReal surface_layer_;
+    int quickstep_iterations_;
+    int auto_disable_;
+    dReal auto_disable_linear_;
+    dReal auto_disable_angular_;
+    int auto_disable_steps_;
+    dReal auto_disable_time_;
+    int auto_disable_samples_;
+
+    MaterialTable materials_;
+    StepMemoryConfig step_memory_;
+    BroadphaseConfig broadphase_;
+    int hash_levels_[2][2];  // min / max level of Space and StaticSpace if they are hash spaces
+
+    std::vector<BodyInfo> bodies_;
+    std::vector<GeomInfo> body_geoms_;
+    std::vector<GeomInfo> static_geoms_;
+};
+
+// Fills every world in 'worlds' with a clone, spread over the pool. Every clone is exactly the source, including
+// whatever InitODE drew from the source's random stream.
+void CloneWorlds(const WorldTemplate& source, std::vector<Simulation>& worlds, ThreadPool& pool);
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef ODE_EXAMPLE_TEST_H
+#define ODE_EXAMPLE_TEST_H
+
+#include "simulation.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+// Just enough for the test programs. CHECK reports a failed condition and carries on with the test, main returns
+// TestResult(), which is what ctest takes as pass or fail.
+
+inline int& TestFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                                                  \
+    do                                                                                                    \
+    {                                                                                                     \
+        if (!(condition))                                                                                 \
+        {                                                                                                 \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl;   \
+            ++TestFailures();                                                                             \
+        }                                                                                                 \
+    } while (0)
+
+inline int TestResult()
+{
+    if (TestFailures())
+        std::cerr << TestFailures() << " check(s) failed" << std::endl;
+    return TestFailures() ? 1 : 0;
+}
+
+// A path in the temporary directory that is unique to this process, so tests can run in parallel
+inline std::string TempPath(const std::string& name)
+{
+    const char* dir = std::getenv("TMPDIR");
+    std::ostringstream path;
+    path << (dir && *dir ? dir : "/tmp") << "/ode_test_" << getpid() << "_" << name;
+    return path.str();
+}
+
+// The whole file, empty if it could not be read
+inline std::vector<char> ReadFile(const std::string& path)
+{
+    std::vector<char> data;
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f)
+        return data;
+
+    char buffer[4096];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), f)) > 0)
+        data.insert(data.end(), buffer, buffer + n);
+    std::fclose(f);
+    return data;
+}
+
+inline void WriteFile(const std::string& path, const std::vector<char>& data)
+{
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    CHECK(f != 0);
+    if (!f)
+        return;
+    if (!data.empty())
+        CHECK(std::fwrite(&data[0], 1, data.size(), f) == data.size());
+    CHECK(std::fclose(f) == 0);
+}
+
+// The tests are about reproducibility, close is not good enough
+inline bool SameBits(const dReal* a, const dReal* b, size_t n)
+{
+    return std::memcmp(a, b, n * sizeof(dReal)) == 0;
+}
+
+// Poses, velocities and enabled flags of all bodies, bit for bit
+inline bool SameBodies(const Simulation& a, const Simulation& b)
+{
+    if (a.Objects.size() != b.Objects.size())
+        return false;
+
+    for(size_t i = 0; i < a.Objects.size(); ++i)
+    {
+        dBodyID ba = a.Objects[i].Body;
+        dBodyID bb = b.Objects[i].Body;
+        if (!SameBits(dBodyGetPosition(ba), dBodyGetPosition(bb), 3) ||
+            !SameBits(dBodyGetQuaternion(ba), dBodyGetQuaternion(bb), 4) ||
+            !SameBits(dBodyGetLinearVel(ba), dBodyGetLinearVel(bb), 3) ||
+            !SameBits(dBodyGetAngularVel(ba), dBodyGetAngularVel(bb), 3) ||
+            dBodyIsEnabled(ba) != dBodyIsEnabled(bb))
+            return false;
+    }
+    return true;
+}
+
+#endif
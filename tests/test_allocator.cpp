@@ -0,0 +1,143 @@
+#include "allocator.h"
+#include "simulation.h"
+#include "test.h"
+
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const size_t SIZES[] = { 1, 16, 100, 1000, 5000, MAX_POOLED_ALLOCATION, 200000 };
+const size_t NUM_SIZES = sizeof(SIZES) / sizeof(SIZES[0]);
+
+void TestStatsBalance()
+{
+    AllocStats before = GetODEAllocStats();
+
+    std::vector<void*> blocks;
+    size_t total = 0;
+    for(size_t i = 0; i < NUM_SIZES; ++i)
+    {
+        void* p = dAlloc(SIZES[i]);
+        CHECK(p != 0);
+        CHECK(((size_t)p & 15) == 0);
+        std::memset(p, (int)i, SIZES[i]);
+        blocks.push_back(p);
+        total += SIZES[i];
+    }
+
+    AllocStats during = GetODEAllocStats();
+    CHECK(during.Allocs - before.Allocs == NUM_SIZES);
+    CHECK(during.BytesInUse - before.BytesInUse == (int64_t)total);
+    CHECK(during.PeakBytesInUse >= during.BytesInUse);
+    // The last two do not fit a size class once the header is added
+    CHECK(during.SystemAllocs - before.SystemAllocs >= 2);
+
+    // Growing within the block keeps it, growing past it moves the contents
+    CHECK(dRealloc(blocks[2], 100, 110) == blocks[2]);
+    void* moved = dRealloc(blocks[3], 1000, 3000);
+    CHECK(moved != 0);
+    CHECK(static_cast<unsigned char*>(moved)[999] == 3);
+    blocks[3] = moved;
+    total += 10 + 2000;
+
+    AllocStats grown = GetODEAllocStats();
+    CHECK(grown.Reallocs - before.Reallocs == 2);
+    CHECK(grown.BytesInUse - before.BytesInUse == (int64_t)total);
+
+    ResetODEAllocPeak();
+    CHECK(GetODEAllocStats().PeakBytesInUse == grown.BytesInUse);
+
+    const size_t sizes_now[] = { 1, 16, 110, 3000, 5000, MAX_POOLED_ALLOCATION, 200000 };
+    for(size_t i = 0; i < blocks.size(); ++i)
+        dFree(blocks[i], sizes_now[i]);
+
+    AllocStats after = GetODEAllocStats();
+    CHECK(after.BytesInUse == before.BytesInUse);
+    CHECK(after.Allocs - before.Allocs == after.Frees - before.Frees);
+    CHECK(after.PeakBytesInUse == grown.BytesInUse);
+}
+
+void AllocAndFree(size_t count, size_t size)
+{
+    std::vector<void*> blocks(count);
+    for(size_t i = 0; i < count; ++i)
+    {
+        blocks[i] = dAlloc(size);
+        std::memset(blocks[i], 0xab, size);
+    }
+    for(size_t i = 0; i < count; ++i)
+        dFree(blocks[i], size);
+}
+
+// The blocks of a thread that has exited are used by the next one, it does not need a chunk of its own
+void TestExitedThreadsLeaveTheirMemory()
+{
+    // About a quarter of a chunk, so the rest of the chunk goes back too
+    const size_t count = 2000;
+    const size_t size = 200;
+
+    AllocStats before = GetODEAllocStats();
+    std::thread first(AllocAndFree, count, size);
+    first.join();
+    AllocStats after_first = GetODEAllocStats();
+    CHECK(after_first.SystemAllocs - before.SystemAllocs == 1);
+
+    for(int i = 0; i < 4; ++i)
+    {
+        std::thread next(AllocAndFree, count, size);
+        next.join();
+    }
+
+    // The unused rest of the first chunk was split into the largest blocks
+    std::thread large(AllocAndFree, 20, MAX_POOLED_ALLOCATION - 1024);
+    large.join();
+    AllocStats after = GetODEAllocStats();
+    CHECK(after.SystemAllocs == after_first.SystemAllocs);
+    CHECK(after.BytesInUse == before.BytesInUse);
+    CHECK(after.Allocs - before.Allocs == after.Frees - before.Frees);
+
+    // Blocks freed on another thread than the one that allocated them
+    std::vector<void*> blocks(100);
+    std::thread producer([&blocks]()
+    {
+        for(size_t i = 0; i < blocks.size(); ++i)
+            blocks[i] = dAlloc(64);
+    });
+    producer.join();
+    CHECK(GetODEAllocStats().BytesInUse == before.BytesInUse + 100 * 64);
+    for(size_t i = 0; i < blocks.size(); ++i)
+        dFree(blocks[i], 64);
+    CHECK(GetODEAllocStats().BytesInUse == before.BytesInUse);
+}
+
+void TestSimulationUsesIt()
+{
+    AllocStats before = GetODEAllocStats();
+
+    Simulation sim;
+    InitODE(sim);
+    RunSteps(sim, 0.01, 1000, REST_STOP);
+    CloseODE(sim);
+
+    AllocStats after = GetODEAllocStats();
+    CHECK(after.Allocs > before.Allocs);
+    CHECK(after.Frees > before.Frees);
+}
+
+}
+
+int main()
+{
+    InstallODEAllocator();
+    CHECK(ODEAllocatorInstalled());
+    dInitODE2(0);
+
+    TestStatsBalance();
+    TestExitedThreadsLeaveTheirMemory();
+    TestSimulationUsesIt();
+
+    dCloseODE();
+    return TestResult();
+}
@@ -0,0 +1,168 @@
+#include "simulation.h"
+#include "test.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+const double DT = 0.01;
+
+size_t AddCube(Simulation& sim, dReal x, dReal y, dReal z, dReal side)
+{
+    dReal pos[3] = { x, y, z };
+    dReal sides[3] = { side, side, side };
+    dMatrix3 R;
+    dRFromAxisAndAngle(R, 0, 1, 0, 0);
+    return AddBox(sim, pos, sides, R);
+}
+
+// The example box falls from a height of 10 with gravity 1, nothing is in reach for the first 400 steps
+void TestFreeFallIsExact()
+{
+    Simulation sim;
+    InitODE(sim);
+    sim.BallisticFastForward = true;
+
+    dBodyID body = sim.Objects[0].Body;
+    dQuaternion q0;
+    std::copy(dBodyGetQuaternion(body), dBodyGetQuaternion(body) + 4, q0);
+
+    const int steps = 300;
+    for(int step = 0; step < steps; ++step)
+        SimLoop(sim, DT);
+
+    // Across more than one flight, still the parabola from the start and not Euler's approximation of it
+    dReal t = steps * DT;
+    const dReal* p = dBodyGetPosition(body);
+    CHECK(std::fabs(p[1] - (10 - t * t / 2)) < 1e-9);
+    CHECK(std::fabs(dBodyGetLinearVel(body)[1] + t) < 1e-9);
+    CHECK(p[0] == 0 && p[2] == -5);
+    CHECK(SameBits(dBodyGetQuaternion(body), q0, 4));
+
+    CHECK(sim.Ballistic.SkippedSteps == (uint64_t)steps);
+    CHECK(sim.Ballistic.BallisticBodySteps == (uint64_t)steps);
+    CHECK(sim.Ballistic.Query != 0);
+
+    // Lands and comes to rest like it does without fast forward
+    RunSteps(sim, DT, 100000, REST_STOP);
+    CHECK(sim.RestStep != NOT_AT_REST);
+    CHECK(p[1] > 0.5 && p[1] < 2.0);
+
+    CancelBallisticFlights(sim);
+    CHECK(!sim.Ballistic.Bodies[0].Active);
+
+    CloseODE(sim);
+    CHECK(sim.Ballistic.Query == 0);
+    CHECK(sim.Ballistic.Bodies.empty());
+}
+
+// A sleeping box under the falling one must be seen by the neighbour query
+void TestLandsOnSleepingBody()
+{
+    Simulation sim;
+    CreateWorld(sim);
+    AddPlane(sim, 0, 1, 0, 0);
+    size_t below = AddCube(sim, 0, 0.5, 0, 1);
+    size_t above = AddCube(sim, 0, 6, 0, 1);
+    TuneSpaces(sim);
+    dBodyDisable(sim.Objects[below].Body);
+    sim.BallisticFastForward = true;
+
+    dReal lowest = 6;
+    for(int step = 0; step < 1000; ++step)
+    {
+        SimLoop(sim, DT);
+        lowest = std::min(lowest, dBodyGetPosition(sim.Objects[above].Body)[1]);
+    }
+
+    CHECK(sim.Ballistic.BallisticBodySteps > 0);
+    CHECK(lowest > 1.3);
+
+    CloseODE(sim);
+}
+
+// Without gravity the resting cube gets the longest possible flight. The other one is pushed towards it, which the
+// bound did not allow for, so the flight has to end before they meet instead of the pushed cube going through.
+void TestFlightEndsWhenSomethingSpeedsUp()
+{
+    Simulation sim;
+    CreateWorld(sim);
+    dWorldSetGravity(sim.World, 0, 0, 0);
+    dWorldSetAutoDisableFlag(sim.World, 0);
+    size_t target = AddCube(sim, 0, 0, 0, 1);
+    size_t pushed = AddCube(sim, -20, 0, 0, 1);
+    TuneSpaces(sim);
+    sim.BallisticFastForward = true;
+
+    dBodyID body = sim.Objects[pushed].Body;
+    dMass m;
+    dBodyGetMass(body, &m);
+
+    for(int step = 0; step < 300; ++step)
+    {
+        dBodyAddForce(body, 10 * m.mass, 0, 0);
+        SimLoop(sim, DT);
+
+        if (step == 0)
+        {
+            CHECK(sim.Ballistic.Bodies[target].Active);
+            CHECK(!sim.Ballistic.Bodies[pushed].Active);
+        }
+    }
+
+    // 20 m at 10 m/s^2 take 2 s, the cube in the way was hit
+    const dReal* p = dBodyGetPosition(sim.Objects[target].Body);
+    CHECK(p[0] > 0.5);
+    CHECK(dBodyGetPosition(body)[0] < p[0]);
+
+    CloseODE(sim);
+}
+
+// A long box precesses and a damped cube slows down, neither follows the closed form. Only the plain cube flies.
+void TestOnlyFreeRotorsFly()
+{
+    Simulation sim;
+    CreateWorld(sim);
+    AddPlane(sim, 0, 1, 0, 0);
+    size_t cube = AddCube(sim, -10, 50, 0, 1);
+    size_t damped = AddCube(sim, 10, 50, 0, 1);
+    dReal pos[3] = { 0, 50, 0 };
+    dReal sides[3] = { 0.5, 0.5, 3 };
+    dMatrix3 R;
+    dRFromAxisAndAngle(R, 1, 0, 0, 0.3);
+    size_t rod = AddBox(sim, pos, sides, R);
+    TuneSpaces(sim);
+    sim.BallisticFastForward = true;
+
+    dBodySetAngularDamping(sim.Objects[damped].Body, 0.1);
+    for(size_t i = 0; i < sim.Objects.size(); ++i)
+        dBodySetAngularVel(sim.Objects[i].Body, 1, 2, 0.5);
+
+    for(int step = 0; step < 100; ++step)
+    {
+        SimLoop(sim, DT);
+        CHECK(sim.Ballistic.Bodies[cube].Active);
+        CHECK(!sim.Ballistic.Bodies[damped].Active);
+        CHECK(!sim.Ballistic.Bodies[rod].Active);
+    }
+    CHECK(sim.Ballistic.BallisticBodySteps == 100);
+
+    CloseODE(sim);
+}
+
+}
+
+int main()
+{
+    dInitODE2(0);
+
+    TestFreeFallIsExact();
+    TestLandsOnSleepingBody();
+    TestFlightEndsWhenSomethingSpeedsUp();
+    TestOnlyFreeRotorsFly();
+
+    dCloseODE();
+    return TestResult();
+}
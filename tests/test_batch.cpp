@@ -0,0 +1,103 @@
+#include "batch.h"
+#include "test.h"
+
+#include <atomic>
+#include <vector>
+
+namespace
+{
+
+void TestParallelForCoversEveryIndex()
+{
+    ThreadPool pool(4);
+    CHECK(pool.NumThreads() == 4);
+
+    const size_t grains[] = { 1, 3, 16, 1000 };
+    for(size_t g = 0; g < sizeof(grains) / sizeof(grains[0]); ++g)
+    {
+        std::vector<std::atomic<int> > visits(997);
+        for(size_t i = 0; i < visits.size(); ++i)
+            visits[i] = 0;
+        std::atomic<bool> bad_thread(false);
+
+        pool.ParallelFor(visits.size(), [&](size_t i, unsigned thread)
+        {
+            ++visits[i];
+            if (thread >= pool.NumThreads())
+                bad_thread = true;
+        }, grains[g]);
+
+        for(size_t i = 0; i < visits.size(); ++i)
+            CHECK(visits[i] == 1);
+        CHECK(!bad_thread);
+    }
+
+    // Nothing to do is fine too
+    pool.ParallelFor(0, [](size_t, unsigned) { CHECK(false); });
+}
+
+bool SameBodies(const BatchSimulation& a, const BatchSimulation& b)
+{
+    if (a.NumWorlds() != b.NumWorlds())
+        return false;
+
+    for(size_t i = 0; i < a.NumWorlds(); ++i)
+    {
+        if (!SameBodies(a.World(i), b.World(i)))
+            return false;
+    }
+    return true;
+}
+
+void TestBatchDoesNotDependOnThreads()
+{
+    BatchSimulation serial(32, 1, 7);
+    BatchSimulation parallel(32, 4, 7);
+    BatchSimulation other_run(32, 4, 8);
+
+    CHECK(SameBodies(serial, parallel));
+    CHECK(!SameBodies(serial, other_run));
+
+    // Worlds differ from each other
+    CHECK(!SameBits(dBodyGetQuaternion(serial.World(0).Objects[0].Body),
+                    dBodyGetQuaternion(serial.World(1).Objects[0].Body), 4));
+
+    // Still in free fall, before the first contact, so ODE's solver has nothing to shuffle
+    for(int step = 0; step < 100; ++step)
+    {
+        serial.Step(0.01);
+        parallel.Step(0.01);
+    }
+    CHECK(SameBodies(serial, parallel));
+    CHECK(serial.World(0).StepCount == 100);
+    CHECK(!serial.AllAtRest());
+}
+
+void TestBatchComesToRest()
+{
+    BatchSimulation batch(8, 2, 1);
+    for(int step = 0; step < 5000 && !batch.AllAtRest(); ++step)
+        batch.Step(0.01);
+
+    CHECK(batch.AllAtRest());
+    for(size_t i = 0; i < batch.NumWorlds(); ++i)
+    {
+        // The box lies on the ground
+        const dReal* pos = dBodyGetPosition(batch.World(i).Objects[0].Body);
+        CHECK(pos[1] > 0.5 && pos[1] < 2.0);
+    }
+}
+
+}
+
+int main()
+{
+    dInitODE2(0);
+
+    TestParallelForCoversEveryIndex();
+    TestBatchDoesNotDependOnThreads();
+    TestBatchComesToRest();
+
+    dCloseODE();
+    return TestResult();
+}
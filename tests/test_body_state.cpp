@@ -0,0 +1,188 @@
+#include "body_state.h"
+#include "test.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+
+const size_t NUM_BODIES = 6;
+
+void Boxes(Simulation& sim, dReal spin)
+{
+    InitODE(sim);
+    for(size_t i = 1; i < NUM_BODIES; ++i)
+    {
+        dReal pos[3] = { 3.0 * i, 2.0 + i, -1.0 * i };
+        dReal sides[3] = { 1, 1, 1 };
+        dMatrix3 R;
+        dRFromAxisAndAngle(R, 1, 1, 0, 0.1 * i);
+        size_t b = AddBox(sim, pos, sides, R);
+        dBodySetLinearVel(sim.Objects[b].Body, 0.5 * i, -0.25 * i, 1.0 / i);
+        dBodySetAngularVel(sim.Objects[b].Body, spin, 0.1 * i, -0.3);
+    }
+    TuneSpaces(sim);
+}
+
+// Entry j of the arrays against body 'body'. Setting a quaternion normalizes it again, which can change the last bit.
+bool Matches(const BodyStateArrays& a, size_t j, dBodyID body, dReal quaternion_tolerance = 0)
+{
+    const dReal* p = dBodyGetPosition(body);
+    const dReal* q = dBodyGetQuaternion(body);
+    const dReal* v = dBodyGetLinearVel(body);
+    const dReal* w = dBodyGetAngularVel(body);
+    for(int k = 0; k < 3; ++k)
+    {
+        if (a.Position[k][j] != p[k] || a.LinearVel[k][j] != v[k] || a.AngularVel[k][j] != w[k])
+            return false;
+    }
+    for(int k = 0; k < 4; ++k)
+    {
+        if (std::fabs(a.Quaternion[k][j] - q[k]) > quaternion_tolerance)
+            return false;
+    }
+    return a.Enabled[j] == (dBodyIsEnabled(body) ? 1 : 0);
+}
+
+void TestBufferLayout()
+{
+    const size_t capacities[] = { 0, 1, 7, 8, 9, 100 };
+    for(size_t c = 0; c < sizeof(capacities) / sizeof(capacities[0]); ++c)
+    {
+        BodyStateBuffer buffer(capacities[c]);
+        CHECK(buffer.Capacity() == capacities[c]);
+        CHECK(buffer.Stride() >= capacities[c] && buffer.Stride() > 0 && buffer.Stride() % 8 == 0);
+
+        const BodyStateArrays& a = buffer.Arrays();
+        std::vector<const void*> planes;
+        for(int k = 0; k < 3; ++k)
+        {
+            planes.push_back(a.Position[k]);
+            planes.push_back(a.LinearVel[k]);
+            planes.push_back(a.AngularVel[k]);
+        }
+        for(int k = 0; k < 4; ++k)
+            planes.push_back(a.Quaternion[k]);
+        planes.push_back(a.Enabled);
+
+        for(size_t i = 0; i < planes.size(); ++i)
+            CHECK(planes[i] != 0 && (size_t)planes[i] % 64 == 0);
+
+        // Planes do not overlap, they are a stride apart
+        CHECK((size_t)((const char*)a.Position[1] - (const char*)a.Position[0]) == buffer.Stride() * sizeof(dReal));
+    }
+
+    // Shrinking keeps the memory, growing replaces it
+    BodyStateBuffer buffer(16);
+    dReal* before = buffer.Arrays().Position[0];
+    buffer.Reserve(4);
+    CHECK(buffer.Arrays().Position[0] == before);
+    CHECK(buffer.Capacity() == 16);
+    buffer.Reserve(17);
+    CHECK(buffer.Capacity() == 17);
+    CHECK(buffer.Stride() == 24);
+}
+
+void TestExport()
+{
+    Simulation sim;
+    Boxes(sim, 0.7);
+    dBodyDisable(sim.Objects[2].Body);
+
+    BodyStateBuffer buffer(NUM_BODIES);
+    const BodyStateArrays& a = buffer.Arrays();
+    ExportBodyStates(sim, a);
+    for(size_t i = 0; i < NUM_BODIES; ++i)
+        CHECK(Matches(a, i, sim.Objects[i].Body));
+
+    // A subset in a different order
+    const uint32_t indices[] = { 5, 0, 2 };
+    ExportBodyStates(sim, a, 3, indices);
+    for(size_t j = 0; j < 3; ++j)
+        CHECK(Matches(a, j, sim.Objects[indices[j]].Body));
+
+    // Only the planes that are asked for are written
+    BodyStateArrays positions;
+    std::vector<dReal> x(NUM_BODIES, -1), y(NUM_BODIES, -1), z(NUM_BODIES, -1);
+    positions.Position[0] = &x[0];
+    positions.Position[1] = &y[0];
+    positions.Position[2] = &z[0];
+    ExportBodyStates(sim, positions);
+    for(size_t i = 0; i < NUM_BODIES; ++i)
+        CHECK(SameBits(dBodyGetPosition(sim.Objects[i].Body) + 1, &y[i], 1));
+
+    CloseODE(sim);
+}
+
+void TestImport()
+{
+    Simulation source;
+    Boxes(source, 0.7);
+    dBodyDisable(source.Objects[3].Body);
+    for(int step = 0; step < 30; ++step)
+        SimLoop(source, 0.01);
+
+    BodyStateBuffer buffer(NUM_BODIES);
+    const BodyStateArrays& a = buffer.Arrays();
+    ExportBodyStates(source, a);
+
+    // Everything, into a world built with other velocities
+    Simulation target;
+    Boxes(target, -2.0);
+    ImportBodyStates(target, a, NUM_BODIES);
+    for(size_t i = 0; i < NUM_BODIES; ++i)
+        CHECK(Matches(a, i, target.Objects[i].Body, 1e-12));
+    CHECK(!dBodyIsEnabled(target.Objects[3].Body));
+
+    // Masked entries are left alone, entries go to the bodies the indices name
+    Simulation partial;
+    Boxes(partial, -2.0);
+    BodyStateBuffer untouched(NUM_BODIES);
+    ExportBodyStates(partial, untouched.Arrays());
+
+    const uint32_t indices[] = { 4, 1 };
+    const uint8_t mask[] = { 1, 0 };
+    BodyStateBuffer picked(2);
+    ExportBodyStates(source, picked.Arrays(), 2, indices);
+    ImportBodyStates(partial, picked.Arrays(), 2, indices, mask);
+    CHECK(Matches(picked.Arrays(), 0, partial.Objects[4].Body, 1e-12));
+    CHECK(Matches(untouched.Arrays(), 1, partial.Objects[1].Body));
+    CHECK(Matches(untouched.Arrays(), 0, partial.Objects[0].Body));
+
+    // Without the enabled plane every written body is woken up
+    dBodyDisable(partial.Objects[0].Body);
+    BodyStateArrays no_enabled = a;
+    no_enabled.Enabled = 0;
+    ImportBodyStates(partial, no_enabled, 1);
+    CHECK(dBodyIsEnabled(partial.Objects[0].Body));
+
+    // Flights in progress end, their bounds were against the old poses
+    partial.BallisticFastForward = true;
+    SimLoop(partial, 0.01);
+    bool flying = false;
+    for(size_t i = 0; i < partial.Ballistic.Bodies.size(); ++i)
+        flying = flying || partial.Ballistic.Bodies[i].Active;
+    CHECK(flying);
+    ImportBodyStates(partial, a, NUM_BODIES);
+    for(size_t i = 0; i < partial.Ballistic.Bodies.size(); ++i)
+        CHECK(!partial.Ballistic.Bodies[i].Active);
+
+    CloseODE(source);
+    CloseODE(target);
+    CloseODE(partial);
+}
+
+}
+
+int main()
+{
+    dInitODE2(0);
+
+    TestBufferLayout();
+    TestExport();
+    TestImport();
+
+    dCloseODE();
+    return TestResult();
+}
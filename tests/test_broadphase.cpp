@@ -0,0 +1,130 @@
+#include "broadphase.h"
+#include "test.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+const BroadphaseType TYPES[] = { BROADPHASE_SIMPLE, BROADPHASE_HASH, BROADPHASE_SAP, BROADPHASE_QUADTREE };
+const size_t NUM_TYPES = sizeof(TYPES) / sizeof(TYPES[0]);
+
+typedef std::vector<std::pair<size_t, size_t> > PairList;
+
+void CollectPair(void* data, dGeomID o1, dGeomID o2)
+{
+    size_t a = (size_t)dGeomGetData(o1);
+    size_t b = (size_t)dGeomGetData(o2);
+    static_cast<PairList*>(data)->push_back(std::make_pair(std::min(a, b), std::max(a, b)));
+}
+
+bool Overlap(const dReal* a, const dReal* b)
+{
+    for(int k = 0; k < 3; ++k)
+    {
+        if (a[2 * k] > b[2 * k + 1] || b[2 * k] > a[2 * k + 1])
+            return false;
+    }
+    return true;
+}
+
+// Deterministic scatter of boxes of different sizes, some of them overlapping
+dReal Scatter(size_t i, unsigned salt)
+{
+    unsigned x = (unsigned)(i * 2654435761u) ^ (salt * 40503u);
+    x ^= x >> 13;
+    x *= 0x5bd1e995;
+    x ^= x >> 15;
+    return (x & 0xffff) / 65535.0;
+}
+
+void TestNames()
+{
+    for(size_t t = 0; t < NUM_TYPES; ++t)
+    {
+        BroadphaseType type = BROADPHASE_SIMPLE;
+        CHECK(ParseBroadphase(BroadphaseName(TYPES[t]), type));
+        CHECK(type == TYPES[t]);
+    }
+
+    BroadphaseType type = BROADPHASE_HASH;
+    CHECK(!ParseBroadphase("octree", type));
+    CHECK(type == BROADPHASE_HASH);
+}
+
+// Every broadphase must report exactly the pairs whose AABBs overlap, no more and no less
+void TestSamePairs()
+{
+    const size_t num_boxes = 300;
+
+    for(size_t t = 0; t < NUM_TYPES; ++t)
+    {
+        BroadphaseConfig config;
+        config.Type = TYPES[t];
+        config.QuadTreeCenter[0] = config.QuadTreeCenter[2] = 10;
+        config.QuadTreeExtents[0] = config.QuadTreeExtents[2] = 24;
+        config.QuadTreeExtents[1] = 24;
+
+        dSpaceID space = CreateSpace(config);
+        static const int CLASSES[] = { dSimpleSpaceClass, dHashSpaceClass, dSweepAndPruneSpaceClass,
+                                       dQuadTreeSpaceClass };
+        CHECK(dSpaceGetClass(space) == CLASSES[t]);
+
+        std::vector<dGeomID> boxes(num_boxes);
+        for(size_t i = 0; i < num_boxes; ++i)
+        {
+            dReal side = i == 0 ? 0.5 : i == 1 ? 3.0 : 0.5 + 2.5 * Scatter(i, 1);
+            boxes[i] = dCreateBox(space, side, side, side);
+            dGeomSetPosition(boxes[i], 20 * Scatter(i, 2), 3 * Scatter(i, 3), 20 * Scatter(i, 4));
+            dGeomSetData(boxes[i], (void*)i);
+        }
+        TuneBroadphase(space, config);
+
+        if (TYPES[t] == BROADPHASE_HASH)
+        {
+            // Smallest cell fits the 0.5 box, the largest the 3 box
+            int min_level, max_level;
+            dHashSpaceGetLevels(space, &min_level, &max_level);
+            CHECK(min_level == -1);
+            CHECK(max_level == 2);
+        }
+
+        PairList expected;
+        for(size_t i = 0; i < num_boxes; ++i)
+        {
+            dReal a[6];
+            dGeomGetAABB(boxes[i], a);
+            for(size_t j = i + 1; j < num_boxes; ++j)
+            {
+                dReal b[6];
+                dGeomGetAABB(boxes[j], b);
+                if (Overlap(a, b))
+                    expected.push_back(std::make_pair(i, j));
+            }
+        }
+        CHECK(!expected.empty());
+
+        PairList pairs;
+        dSpaceCollide(space, &pairs, &CollectPair);
+        std::sort(pairs.begin(), pairs.end());
+
+        CHECK(pairs == expected);
+
+        dSpaceDestroy(space);
+    }
+}
+
+}
+
+int main()
+{
+    dInitODE2(0);
+
+    TestNames();
+    TestSamePairs();
+
+    dCloseODE();
+    return TestResult();
+}
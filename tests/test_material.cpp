@@ -0,0 +1,49 @@
+#include "material.h"
+#include "test.h"
+
+namespace
+{
+
+void TestSurfaces()
+{
+    MaterialTable table;
+    AddDefaultMaterials(table);
+    MaterialID ice;
+    CHECK(FindMaterial(table, "ice", ice));
+    MaterialID unknown;
+    CHECK(!FindMaterial(table, "wood", unknown));
+    BuildSurfaces(table);
+
+    // An infinite friction defers to the other material, the bouncier one wins
+    const dSurfaceParameters& s = LookupSurface(table, 0, ice);
+    CHECK(s.mu == table.Materials[ice].Friction);
+    CHECK(s.bounce == table.Materials[ice].Bounce);
+    CHECK(&LookupSurface(table, ice, 0) != &s);
+    CHECK(LookupSurface(table, ice, 0).mu == s.mu);
+
+    // Ids the table does not know are material 0
+    CHECK(&LookupSurface(table, 900, ice) == &s);
+    CHECK(&LookupSurface(table, NO_MATERIAL, 0) == &LookupSurface(table, 0, 0));
+}
+
+void TestFullTable()
+{
+    MaterialTable table;
+    Material m;
+    for(size_t i = 0; i < MAX_MATERIALS; ++i)
+        CHECK(AddMaterial(table, m) == (MaterialID)i);
+
+    // The next one would wrap around to id 0
+    CHECK(AddMaterial(table, m) == NO_MATERIAL);
+    CHECK(table.Materials.size() == MAX_MATERIALS);
+}
+
+}
+
+int main()
+{
+    TestSurfaces();
+    TestFullTable();
+
+    return TestResult();
+}
@@ -0,0 +1,244 @@
+#include "monte_carlo.h"
+#include "simulation.h"
+#include "test.h"
+#include "thread_pool.h"
+
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+
+// Just enough of a JSON parser to tell whether a document is well formed
+class JsonChecker
+{
+public:
+    explicit JsonChecker(const std::string& text) : s_(text), p_(0) {}
+
+    bool Valid()
+    {
+        return Value() && (Space(), p_ == s_.size());
+    }
+
+private:
+    void Space()
+    {
+        while (p_ < s_.size() && std::isspace((unsigned char)s_[p_]))
+            ++p_;
+    }
+
+    bool Eat(char c)
+    {
+        Space();
+        if (p_ < s_.size() && s_[p_] == c)
+        {
+            ++p_;
+            return true;
+        }
+        return false;
+    }
+
+    bool String()
+    {
+        if (!Eat('"'))
+            return false;
+        while (p_ < s_.size() && s_[p_] != '"')
+            p_ += s_[p_] == '\\' ? 2 : 1;
+        return p_++ < s_.size();
+    }
+
+    bool Number()
+    {
+        const char* start = s_.c_str() + p_;
+        if (*start != '-' && !std::isdigit((unsigned char)*start))
+            return false;
+        char* end;
+        std::strtod(start, &end);
+        p_ += end - start;
+        return end != start;
+    }
+
+    bool List(char close, bool object)
+    {
+        if (Eat(close))
+            return true;
+        do
+        {
+            if (object && !(String() && Eat(':')))
+                return false;
+            if (!Value())
+                return false;
+        } while (Eat(','));
+        return Eat(close);
+    }
+
+    bool Value()
+    {
+        Space();
+        if (p_ >= s_.size())
+            return false;
+        char c = s_[p_];
+        if (c == '{' || c == '[')
+        {
+            ++p_;
+            return List(c == '{' ? '}' : ']', c == '{');
+        }
+        if (c == '"')
+            return String();
+        return Number();
+    }
+
+    std::string s_;
+    size_t p_;
+};
+
+bool ValidJsonFile(const std::string& path)
+{
+    std::ifstream in(path.c_str());
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return !text.empty() && JsonChecker(text).Valid();
+}
+
+bool SameStats(const MonteCarloStats& a, const MonteCarloStats& b)
+{
+    return a.Samples == b.Samples && a.Settled == b.Settled && SameBits(&a.RestTimeMean, &b.RestTimeMean, 1) &&
+           SameBits(&a.RestTimeM2, &b.RestTimeM2, 1) && a.RestTimeHistogram == b.RestTimeHistogram &&
+           a.Contacts == b.Contacts && a.MaxContacts == b.MaxContacts &&
+           std::memcmp(a.FaceUp, b.FaceUp, sizeof(a.FaceUp)) == 0 && a.PositionHistogram == b.PositionHistogram &&
+           a.OutsidePosition == b.OutsidePosition;
+}
+
+void TestParse()
+{
+    Distribution d;
+    CHECK(Distribution::Parse("fixed:2.5", d) && d.Type == Distribution::FIXED && d.A == 2.5);
+    CHECK(Distribution::Parse("uniform:-1:3", d) && d.Type == Distribution::UNIFORM && d.A == -1 && d.B == 3);
+    CHECK(Distribution::Parse("uniform:1:1", d));
+    CHECK(Distribution::Parse("normal:0:2", d) && d.Type == Distribution::NORMAL && d.B == 2);
+
+    Distribution round_trip;
+    CHECK(Distribution::Parse(Distribution(Distribution::UNIFORM, 0.1, 1.0 / 3).ToString(), round_trip));
+    CHECK(round_trip.A == 0.1 && round_trip.B == 1.0 / 3);
+
+    const char* bad[] = { "", "fixed", "fixed:", "fixed:1:2", "uniform:1", "uniform:2:1", "normal:0:-1",
+                          "normal:0:1:2", "fixed:nan", "uniform:0:inf", "fixed:1x", "gamma:1:2" };
+    for(size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i)
+    {
+        d = Distribution(Distribution::FIXED, 7);
+        CHECK(!Distribution::Parse(bad[i], d));
+    }
+
+    CHECK(Distribution(Distribution::FIXED, 0.5).IsPositive());
+    CHECK(Distribution(Distribution::UNIFORM, 0.1, 2).IsPositive());
+    CHECK(Distribution(Distribution::NORMAL, 1, 0).IsPositive());
+    CHECK(!Distribution(Distribution::FIXED, 0).IsPositive());
+    CHECK(!Distribution(Distribution::UNIFORM, -0.1, 2).IsPositive());
+    CHECK(!Distribution(Distribution::NORMAL, 5, 0.1).IsPositive());
+}
+
+void TestInvalidConfigs()
+{
+    ThreadPool pool(1);
+    std::vector<MonteCarloConfig> configs(6);
+    configs[0].PositionBins = 0;
+    configs[1].RestTimeBins = 0;
+    configs[2].TimeStep = 0;
+    configs[3].PositionRange = -1;
+    configs[4].Density = Distribution(Distribution::NORMAL, 0.5, 0.1);
+    configs[5].Height = Distribution(Distribution::UNIFORM, 10, 5);
+
+    CHECK(MonteCarloConfigError(MonteCarloConfig()) == 0);
+    for(size_t i = 0; i < configs.size(); ++i)
+    {
+        configs[i].Samples = 10;
+        CHECK(MonteCarloConfigError(configs[i]) != 0);
+
+        MonteCarloStats stats;
+        stats.Samples = 3;
+        CHECK(!RunMonteCarlo(configs[i], pool, "", stats));
+        CHECK(stats.Samples == 0);
+    }
+}
+
+// Falling for at most 300 steps from 9 m or more at 1 m/s^2 nothing touches the ground, so ODE's solver has no
+// contacts to shuffle and the results do not depend on the threads
+void TestDoesNotDependOnThreads()
+{
+    MonteCarloConfig config;
+    config.Samples = 500;
+    config.RunId = 11;
+    config.MaxSteps = 300;
+    config.Height = Distribution(Distribution::UNIFORM, 9, 11);
+    config.VelocityX = Distribution(Distribution::NORMAL, 0, 2);
+    config.VelocityZ = Distribution(Distribution::NORMAL, 0, 2);
+    config.Density = Distribution(Distribution::UNIFORM, 0.2, 2);
+    config.PositionBins = 8;
+    config.BlockSize = 16;
+
+    std::string path = TempPath("monte_carlo.json");
+
+    MonteCarloStats serial;
+    ThreadPool one(1);
+    CHECK(RunMonteCarlo(config, one, "", serial));
+
+    MonteCarloStats parallel;
+    ThreadPool four(4);
+    CHECK(RunMonteCarlo(config, four, path, parallel));
+    CHECK(SameStats(serial, parallel));
+    CHECK(ValidJsonFile(path));
+
+    CHECK(serial.Samples == config.Samples);
+    CHECK(serial.Settled == 0 && serial.Contacts == 0);
+    uint64_t faces = 0;
+    for(int i = 0; i < 6; ++i)
+        faces += serial.FaceUp[i];
+    CHECK(faces == config.Samples);
+    uint64_t positions = serial.OutsidePosition;
+    for(size_t i = 0; i < serial.PositionHistogram.size(); ++i)
+        positions += serial.PositionHistogram[i];
+    CHECK(positions == config.Samples);
+    CHECK(serial.OutsidePosition > 0 && serial.OutsidePosition < config.Samples);
+
+    // Another run id gives other samples
+    config.RunId = 12;
+    MonteCarloStats other;
+    CHECK(RunMonteCarlo(config, four, "", other));
+    CHECK(other.PositionHistogram != serial.PositionHistogram);
+
+    std::remove(path.c_str());
+}
+
+void TestEmptyStatsAreValidJson()
+{
+    std::string path = TempPath("monte_carlo_empty.json");
+    CHECK(WriteMonteCarloStats(path, MonteCarloConfig(), MonteCarloStats()));
+    CHECK(ValidJsonFile(path));
+
+    // A single row and a single entry
+    MonteCarloConfig config;
+    config.PositionBins = 1;
+    MonteCarloStats stats;
+    stats.PositionHistogram.assign(1, 4);
+    stats.RestTimeHistogram.assign(1, 2);
+    CHECK(WriteMonteCarloStats(path, config, stats));
+    CHECK(ValidJsonFile(path));
+
+    std::remove(path.c_str());
+}
+
+}
+
+int main()
+{
+    dInitODE2(0);
+
+    TestParse();
+    TestInvalidConfigs();
+    TestDoesNotDependOnThreads();
+    TestEmptyStatsAreValidJson();
+
+    dCloseODE();
+    return TestResult();
+}
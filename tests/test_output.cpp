@@ -0,0 +1,203 @@
+#include "output.h"
+#include "test.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+// Keeps every snapshot it is given, optionally taking its time about it
+class MemorySink : public OutputSink
+{
+public:
+    explicit MemorySink(int delay_micros = 0) : delay_micros_(delay_micros) {}
+
+    bool IsOpen() const { return true; }
+
+    bool Write(const BodySnapshot& snapshot)
+    {
+        if (delay_micros_ > 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(delay_micros_));
+        Snapshots.push_back(snapshot);
+        return true;
+    }
+
+    std::vector<BodySnapshot> Snapshots;
+
+private:
+    int delay_micros_;
+};
+
+// The example box and a second one, stepped once per push so every snapshot is different
+class Source
+{
+public:
+    Source()
+    {
+        InitODE(sim_);
+        dReal pos[3] = { 3, 5, 0 };
+        dReal sides[3] = { 1, 1, 1 };
+        dMatrix3 R;
+        dRSetIdentity(R);
+        AddBox(sim_, pos, sides, R);
+    }
+
+    ~Source()
+    {
+        CloseODE(sim_);
+    }
+
+    // Steps the world and pushes it as the given step, remembering the heights it pushed
+    bool Push(OutputPipeline& output, uint64_t step)
+    {
+        SimLoop(sim_, 0.01);
+        for(size_t i = 0; i < sim_.Objects.size(); ++i)
+            heights_.push_back(dBodyGetPosition(sim_.Objects[i].Body)[1]);
+        return output.Push(step, sim_);
+    }
+
+    size_t NumBodies() const { return sim_.Objects.size(); }
+
+    // Whether the sink got the states of exactly these steps
+    bool Wrote(const MemorySink& sink, const std::vector<uint64_t>& steps) const
+    {
+        if (sink.Snapshots.size() != steps.size())
+            return false;
+        for(size_t s = 0; s < steps.size(); ++s)
+        {
+            const BodySnapshot& snapshot = sink.Snapshots[s];
+            if (snapshot.Step != steps[s] || snapshot.Bodies.size() != NumBodies())
+                return false;
+            for(size_t i = 0; i < snapshot.Bodies.size(); ++i)
+            {
+                const TrajectorySample& sample = snapshot.Bodies[i];
+                if (sample.Step != steps[s] || sample.Body != i ||
+                    !SameBits(&sample.Position[1], &heights_[steps[s] * NumBodies() + i], 1))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    Simulation sim_;
+    std::vector<dReal> heights_;  // per pushed step and body
+};
+
+std::vector<uint64_t> Steps(uint64_t first, uint64_t end, uint64_t stride = 1)
+{
+    std::vector<uint64_t> steps;
+    for(uint64_t step = first; step < end; step += stride)
+        steps.push_back(step);
+    return steps;
+}
+
+// With the writer not running the ring fills up, everything after that is dropped
+void TestDrop()
+{
+    Source source;
+    MemorySink sink;
+    OutputConfig config;
+    config.Capacity = 4;
+    OutputPipeline output(sink, source.NumBodies(), config);
+
+    for(uint64_t step = 0; step < 10; ++step)
+        CHECK(source.Push(output, step) == (step < 4));
+
+    OutputStats stats = output.Stats();
+    CHECK(stats.Pushed == 4 && stats.Dropped == 6 && stats.Downsampled == 0 && stats.Written == 0);
+
+    output.Start();
+    output.Stop();
+    CHECK(output.Stats().Written == 4);
+    CHECK(source.Wrote(sink, Steps(0, 4)));
+}
+
+// Once the ring is half full only every 4th snapshot goes in, and when it is full nothing does
+void TestDownsample()
+{
+    Source source;
+    MemorySink sink;
+    OutputConfig config;
+    config.Capacity = 8;
+    config.Policy = OUTPUT_DOWNSAMPLE;
+    config.DownsampleFactor = 4;
+    config.DownsampleThreshold = 0.5;
+    OutputPipeline output(sink, source.NumBodies(), config);
+
+    for(uint64_t step = 0; step < 21; ++step)
+        CHECK(source.Push(output, step) == (step < 4 || (step < 20 && step % 4 == 0)));
+
+    OutputStats stats = output.Stats();
+    CHECK(stats.Pushed == 8 && stats.Downsampled == 12 && stats.Dropped == 1);
+
+    output.Start();
+    output.Stop();
+    std::vector<uint64_t> steps = Steps(0, 4);
+    std::vector<uint64_t> kept = Steps(4, 20, 4);
+    steps.insert(steps.end(), kept.begin(), kept.end());
+    CHECK(source.Wrote(sink, steps));
+}
+
+// A slow writer makes the physics wait, but nothing is lost
+void TestBackpressure()
+{
+    Source source;
+    MemorySink sink(500);
+    OutputConfig config;
+    config.Capacity = 2;
+    config.Policy = OUTPUT_BACKPRESSURE;
+    OutputPipeline output(sink, source.NumBodies(), config);
+
+    output.Start();
+    for(uint64_t step = 0; step < 50; ++step)
+        CHECK(source.Push(output, step));
+    output.Stop();
+
+    OutputStats stats = output.Stats();
+    CHECK(stats.Pushed == 50 && stats.Written == 50 && stats.Dropped == 0 && stats.Downsampled == 0);
+    CHECK(stats.BackpressureWaits > 0 && stats.BackpressureNanos > 0);
+    CHECK(source.Wrote(sink, Steps(0, 50)));
+
+    // Without a writer there is nobody to wait for, a full ring drops
+    MemorySink idle_sink;
+    OutputPipeline idle(idle_sink, source.NumBodies(), config);
+    CHECK(source.Push(idle, 0) && source.Push(idle, 1));
+    CHECK(!source.Push(idle, 2));
+    CHECK(idle.Stats().Dropped == 1);
+}
+
+// A world with another number of bodies would only fill part of a snapshot, it is refused
+void TestWrongBodyCount()
+{
+    Source source;
+    MemorySink sink;
+    OutputPipeline more(sink, source.NumBodies() + 1);
+    OutputPipeline fewer(sink, source.NumBodies() - 1);
+
+    CHECK(!source.Push(more, 0));
+    CHECK(!source.Push(fewer, 1));
+    CHECK(more.Stats().WrongBodyCount == 1 && more.Stats().Pushed == 0 && more.Stats().Dropped == 0);
+    CHECK(fewer.Stats().WrongBodyCount == 1 && fewer.Stats().Pushed == 0);
+
+    more.Start();
+    more.Stop();
+    CHECK(sink.Snapshots.empty());
+}
+
+}
+
+int main()
+{
+    dInitODE2(0);
+
+    TestDrop();
+    TestDownsample();
+    TestBackpressure();
+    TestWrongBodyCount();
+
+    dCloseODE();
+    return TestResult();
+}
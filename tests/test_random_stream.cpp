@@ -0,0 +1,128 @@
+#include "random_stream.h"
+#include "test.h"
+
+#include <vector>
+
+namespace
+{
+
+// The Philox4x32-10 known answers of Random123 (kat_vectors)
+void TestKnownAnswers()
+{
+    struct Vector
+    {
+        uint32_t Counter[4];
+        uint32_t Key[2];
+        uint32_t Out[4];
+    };
+    const Vector vectors[] =
+    {
+        { { 0, 0, 0, 0 }, { 0, 0 }, { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } },
+        { { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff }, { 0xffffffff, 0xffffffff },
+          { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd } },
+        { { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 }, { 0xa4093822, 0x299f31d0 },
+          { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } },
+    };
+
+    for(size_t v = 0; v < sizeof(vectors) / sizeof(vectors[0]); ++v)
+    {
+        uint32_t out[4];
+        RandomStream::Philox(vectors[v].Counter, vectors[v].Key, out);
+        for(int i = 0; i < 4; ++i)
+            CHECK(out[i] == vectors[v].Out[i]);
+    }
+
+    // Stream 0 of run 0 starts with the first vector
+    RandomStream stream;
+    for(int i = 0; i < 4; ++i)
+        CHECK(stream.NextU32() == vectors[0].Out[i]);
+}
+
+// The n-th block of a stream is the block function of (n, stream id) under the run id
+void TestStreamLayout()
+{
+    const uint64_t run_id = 0x0123456789abcdefull;
+    const uint64_t stream_id = 0xfedcba9876543210ull;
+    RandomStream stream(run_id, stream_id);
+
+    const uint32_t key[2] = { (uint32_t)run_id, (uint32_t)(run_id >> 32) };
+    for(uint32_t n = 0; n < 5; ++n)
+    {
+        const uint32_t counter[4] = { n, 0, (uint32_t)stream_id, (uint32_t)(stream_id >> 32) };
+        uint32_t block[4];
+        RandomStream::Philox(counter, key, block);
+        for(int i = 0; i < 4; ++i)
+            CHECK(stream.NextU32() == block[i]);
+    }
+}
+
+std::vector<uint32_t> Draw(RandomStream stream, size_t n)
+{
+    std::vector<uint32_t> numbers(n);
+    for(size_t i = 0; i < n; ++i)
+        numbers[i] = stream.NextU32();
+    return numbers;
+}
+
+void TestStreamsAreIndependent()
+{
+    const size_t n = 64;
+    std::vector<uint32_t> base = Draw(RandomStream(1, 0), n);
+    CHECK(Draw(RandomStream(1, 0), n) == base);
+
+    // Another world of the same run, the same world of another run, and ids that only differ in the high half
+    const RandomStream others[] = { RandomStream(1, 1), RandomStream(2, 0), RandomStream(1ull << 32 | 1, 0),
+                                    RandomStream(1, 1ull << 32) };
+    for(size_t s = 0; s < sizeof(others) / sizeof(others[0]); ++s)
+    {
+        std::vector<uint32_t> numbers = Draw(others[s], n);
+        size_t same = 0;
+        for(size_t i = 0; i < n; ++i)
+            same += numbers[i] == base[i];
+        CHECK(same <= 1);
+    }
+
+    // Drawing from one stream does not move another
+    RandomStream a(4, 0);
+    RandomStream b(4, 1);
+    std::vector<uint32_t> b_alone = Draw(RandomStream(4, 1), 8);
+    for(int i = 0; i < 100; ++i)
+        a.NextU32();
+    CHECK(Draw(b, 8) == b_alone);
+}
+
+void TestReals()
+{
+    RandomStream stream(9, 3);
+    double sum = 0;
+    const int n = 100000;
+    for(int i = 0; i < n; ++i)
+    {
+        double r = stream.NextReal();
+        CHECK(r >= 0 && r < 1);
+        sum += r;
+
+        double u = stream.Uniform(-2, 3);
+        CHECK(u >= -2 && u < 3);
+    }
+    CHECK(sum / n > 0.49 && sum / n < 0.51);
+
+    // Two numbers per real, the first one gives the high bits
+    RandomStream numbers(9, 4);
+    RandomStream reals(9, 4);
+    uint32_t a = numbers.NextU32() >> 5;
+    uint32_t b = numbers.NextU32() >> 6;
+    CHECK(reals.NextReal() == (a * 67108864.0 + b) / 9007199254740992.0);
+}
+
+}
+
+int main()
+{
+    TestKnownAnswers();
+    TestStreamLayout();
+    TestStreamsAreIndependent();
+    TestReals();
+
+    return TestResult();
+}
@@ -0,0 +1,140 @@
+#include "rewind.h"
+#include "test.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+
+const double DT = 0.01;
+
+// Bit for bit, except for quaternions when given a tolerance. RestoreWorldState goes through dBodySetQuaternion,
+// which normalizes once more and may round the last bit differently.
+bool SameState(const WorldState& a, const WorldState& b, dReal quaternion_tolerance = 0)
+{
+    if (a.Quaternion.size() != b.Quaternion.size())
+        return false;
+    for(size_t k = 0; k < a.Quaternion.size(); ++k)
+    {
+        if (std::fabs(a.Quaternion[k] - b.Quaternion[k]) > quaternion_tolerance)
+            return false;
+    }
+    return a.Step == b.Step && a.RestStep == b.RestStep && a.Enabled == b.Enabled &&
+           a.Position.size() == b.Position.size() &&
+           SameBits(&a.Position[0], &b.Position[0], a.Position.size()) &&
+           SameBits(&a.LinearVel[0], &b.LinearVel[0], a.LinearVel.size()) &&
+           SameBits(&a.AngularVel[0], &b.AngularVel[0], a.AngularVel.size());
+}
+
+// The example box is in free fall for its first 400 steps, so replaying a stretch of them gives the same bits
+void TestRestoreAndReplay()
+{
+    Simulation sim;
+    InitODE(sim);
+    dBodySetAngularVel(sim.Objects[0].Body, 0.3, -0.2, 0.1);
+
+    for(int step = 0; step < 20; ++step)
+        SimLoop(sim, DT);
+    WorldState saved;
+    CaptureWorldState(sim, saved);
+    CHECK(saved.Step == 20);
+    CHECK(saved.Position.size() == 3 && saved.Quaternion.size() == 4 && saved.Enabled.size() == 1);
+
+    // Both runs start from a restore, so they start from the same bits
+    RestoreWorldState(sim, saved);
+    WorldState restored;
+    CaptureWorldState(sim, restored);
+    CHECK(SameState(saved, restored, 1e-12));
+
+    for(int step = 0; step < 60; ++step)
+        SimLoop(sim, DT);
+    WorldState first_run;
+    CaptureWorldState(sim, first_run);
+    CHECK(!SameState(saved, first_run, 1e-12));
+
+    RestoreWorldState(sim, saved);
+    CHECK(sim.StepCount == 20);
+
+    for(int step = 0; step < 60; ++step)
+        SimLoop(sim, DT);
+    WorldState second_run;
+    CaptureWorldState(sim, second_run);
+    CHECK(SameState(first_run, second_run));
+
+    // Disabled bodies come back disabled
+    dBodyDisable(sim.Objects[0].Body);
+    CaptureWorldState(sim, saved);
+    dBodyEnable(sim.Objects[0].Body);
+    RestoreWorldState(sim, saved);
+    CHECK(!dBodyIsEnabled(sim.Objects[0].Body));
+
+    CloseODE(sim);
+}
+
+void TestRewindBuffer()
+{
+    CHECK(RewindBuffer(0, 0).Capacity() == 1);
+    CHECK(RewindBuffer(0, 0).Interval() == 1);
+
+    Simulation sim;
+    InitODE(sim);
+    RewindBuffer rewind(4, 10);
+    sim.Rewind = &rewind;
+
+    std::vector<WorldState> history(101);
+    CaptureWorldState(sim, history[0]);
+    for(int step = 1; step <= 100; ++step)
+    {
+        SimLoop(sim, DT);
+        CaptureWorldState(sim, history[step]);
+    }
+
+    // Every 10th step, only the last 4 of them are kept
+    CHECK(rewind.Size() == 4);
+    CHECK(rewind.OldestStep() == 70);
+    CHECK(rewind.NewestStep() == 100);
+
+    // Too old, nothing happens
+    CHECK(!rewind.Rewind(sim, 65));
+    CHECK(sim.StepCount == 100);
+    CHECK(rewind.Size() == 4);
+
+    // Goes back to the newest state at or before the step and forgets the ones after it
+    CHECK(rewind.Rewind(sim, 85));
+    CHECK(sim.StepCount == 80);
+    CHECK(rewind.Size() == 2);
+    CHECK(rewind.NewestStep() == 80);
+
+    WorldState state;
+    CaptureWorldState(sim, state);
+    CHECK(SameState(state, history[80], 1e-12));
+
+    // Simulating again captures again and ends where the first run did
+    for(int step = 81; step <= 100; ++step)
+        SimLoop(sim, DT);
+    CHECK(rewind.Size() == 4);
+    CHECK(rewind.NewestStep() == 100);
+    CaptureWorldState(sim, state);
+    CHECK(SameState(state, history[100], 1e-12));
+
+    rewind.Clear();
+    CHECK(rewind.Size() == 0);
+    CHECK(!rewind.Rewind(sim, 100));
+
+    sim.Rewind = 0;
+    CloseODE(sim);
+}
+
+}
+
+int main()
+{
+    dInitODE2(0);
+
+    TestRestoreAndReplay();
+    TestRewindBuffer();
+
+    dCloseODE();
+    return TestResult();
+}
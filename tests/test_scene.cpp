@@ -0,0 +1,304 @@
+#include "scene.h"
+#include "simulation.h"
+#include "test.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+namespace
+{
+
+// Where the binary header keeps the body count and the world, see SceneFileHeader. The materials follow the header,
+// each with a 32 byte name before its density (SceneFileMaterial).
+const long NUM_BODIES_OFFSET = 24;
+const long WORLD_OFFSET = 32;
+const long MATERIAL_DENSITY_OFFSET = 32;
+
+Scene MakeScene()
+{
+    Scene scene;
+    scene.World.Gravity[1] = -9.81;
+    scene.World.CFM = 1.0 / 3.0;
+    scene.World.QuickStepIterations = 7;
+    scene.World.Broadphase = BROADPHASE_SAP;
+    scene.World.IslandThreads = 2;
+
+    Material rubber;
+    rubber.Name = "rubber";
+    rubber.Density = 1.1;
+    rubber.Friction = dInfinity;
+    rubber.Bounce = 0.8;
+    rubber.BounceVel = 0.01;
+    rubber.SoftCFM = 1e-4;
+    Material ice = rubber;
+    ice.Name = "ice";
+    ice.Friction = 0.01;
+    scene.Materials.push_back(rubber);
+    scene.Materials.push_back(ice);
+
+    SceneGeom plane = SceneGeom();
+    plane.Shape = SHAPE_PLANE;
+    plane.Material = 1;
+    plane.Size[1] = 1;
+    plane.Position[0] = -0.5;
+    plane.Quaternion[0] = 1;
+    scene.Static.push_back(plane);
+
+    SceneGeom wall = SceneGeom();
+    wall.Shape = SHAPE_BOX;
+    wall.Size[0] = 10;
+    wall.Size[1] = 3;
+    wall.Size[2] = 0.25;
+    wall.Position[2] = 4;
+    wall.Quaternion[0] = 0.6;
+    wall.Quaternion[2] = 0.8;
+    scene.Static.push_back(wall);
+
+    // One body of every shape, with values that do not print exactly in fewer than 17 digits
+    for(int shape = SHAPE_BOX; shape <= SHAPE_CYLINDER; ++shape)
+    {
+        SceneBody b = SceneBody();
+        b.Shape = shape;
+        b.Material = shape % 2;
+        for(int k = 0; k < 3; ++k)
+        {
+            b.Size[k] = shape == SHAPE_SPHERE && k > 0 ? 0 : shape == SHAPE_BOX || k < 2 ? 0.1 * (k + 1) + shape : 0;
+            b.Position[k] = shape * 2.0 + k / 3.0;
+            b.LinearVel[k] = -0.1 * k;
+            b.AngularVel[k] = 1e-7 * (shape + k);
+        }
+        b.Quaternion[0] = 1;
+        scene.Bodies.push_back(b);
+    }
+    return scene;
+}
+
+bool SameScene(const Scene& a, const Scene& b)
+{
+    const SceneWorld& wa = a.World;
+    const SceneWorld& wb = b.World;
+    if (!SameBits(wa.Gravity, wb.Gravity, 3) || !SameBits(&wa.ERP, &wb.ERP, 1) || !SameBits(&wa.CFM, &wb.CFM, 1) ||
+        !SameBits(&wa.MaxCorrectingVel, &wb.MaxCorrectingVel, 1) || !SameBits(&wa.SurfaceLayer, &wb.SurfaceLayer, 1) ||
+        wa.AutoDisable != wb.AutoDisable || wa.QuickStepIterations != wb.QuickStepIterations ||
+        wa.Broadphase != wb.Broadphase || wa.IslandThreads != wb.IslandThreads)
+        return false;
+
+    if (a.Materials.size() != b.Materials.size() || a.Static.size() != b.Static.size() ||
+        a.Bodies.size() != b.Bodies.size())
+        return false;
+
+    for(size_t i = 0; i < a.Materials.size(); ++i)
+    {
+        const Material& ma = a.Materials[i];
+        const Material& mb = b.Materials[i];
+        if (ma.Name != mb.Name || !SameBits(&ma.Density, &mb.Density, 1) || !SameBits(&ma.Friction, &mb.Friction, 1) ||
+            !SameBits(&ma.Bounce, &mb.Bounce, 1) || !SameBits(&ma.BounceVel, &mb.BounceVel, 1) ||
+            !SameBits(&ma.SoftCFM, &mb.SoftCFM, 1))
+            return false;
+    }
+
+    for(size_t i = 0; i < a.Static.size(); ++i)
+    {
+        const SceneGeom& ga = a.Static[i];
+        const SceneGeom& gb = b.Static[i];
+        if (ga.Shape != gb.Shape || ga.Material != gb.Material || !SameBits(ga.Size, gb.Size, 3) ||
+            !SameBits(ga.Position, gb.Position, 3) || !SameBits(ga.Quaternion, gb.Quaternion, 4))
+            return false;
+    }
+
+    for(size_t i = 0; i < a.Bodies.size(); ++i)
+    {
+        const SceneBody& ba = a.Bodies[i];
+        const SceneBody& bb = b.Bodies[i];
+        if (ba.Shape != bb.Shape || ba.Material != bb.Material || !SameBits(ba.Size, bb.Size, 3) ||
+            !SameBits(ba.Position, bb.Position, 3) || !SameBits(ba.Quaternion, bb.Quaternion, 4) ||
+            !SameBits(ba.LinearVel, bb.LinearVel, 3) || !SameBits(ba.AngularVel, bb.AngularVel, 3))
+            return false;
+    }
+    return true;
+}
+
+void WriteText(const std::string& path, const char* text)
+{
+    WriteFile(path, std::vector<char>(text, text + std::strlen(text)));
+}
+
+void TestRoundTrip()
+{
+    Scene scene = MakeScene();
+    std::string text_path = TempPath("scene.scene");
+    std::string binary_path = TempPath("scene.bin");
+
+    CHECK(SaveSceneText(text_path, scene));
+    Scene from_text;
+    CHECK(LoadScene(text_path, from_text));
+    CHECK(SameScene(scene, from_text));
+
+    CHECK(SaveSceneBinary(binary_path, from_text));
+    Scene from_binary;
+    CHECK(LoadScene(binary_path, from_binary));
+    CHECK(SameScene(scene, from_binary));
+
+    // And back to text, which is the same file as before
+    std::string again_path = TempPath("scene_again.scene");
+    CHECK(SaveSceneText(again_path, from_binary));
+    CHECK(ReadFile(again_path) == ReadFile(text_path));
+
+    // The loaded scene builds into a world
+    Simulation sim;
+    BuildScene(sim, from_binary);
+    CHECK(sim.Objects.size() == scene.Bodies.size());
+    CHECK(dSpaceGetNumGeoms(sim.StaticSpace) == 2);
+    CHECK(dSpaceGetNumGeoms(sim.Space) == (int)scene.Bodies.size());
+    CloseODE(sim);
+
+    std::remove(text_path.c_str());
+    std::remove(binary_path.c_str());
+    std::remove(again_path.c_str());
+}
+
+void TestRejectsCorruptBinary()
+{
+    std::string good_path = TempPath("good.bin");
+    std::string bad_path = TempPath("bad.bin");
+    CHECK(SaveSceneBinary(good_path, MakeScene()));
+    const std::vector<char> good = ReadFile(good_path);
+    CHECK(good.size() > (size_t)WORLD_OFFSET + sizeof(SceneWorld));
+
+    Scene scene;
+
+    // Cut off in the middle of the last body, and in the middle of the header
+    WriteFile(bad_path, std::vector<char>(good.begin(), good.end() - 8));
+    CHECK(!LoadSceneBinary(bad_path, scene));
+    CHECK(scene.Bodies.empty());
+    WriteFile(bad_path, std::vector<char>(good.begin(), good.begin() + 20));
+    CHECK(!LoadScene(bad_path, scene));
+
+    // A body count far beyond the file size must not be allocated
+    std::vector<char> data = good;
+    uint64_t huge = (uint64_t)1 << 60;
+    std::memcpy(&data[NUM_BODIES_OFFSET], &huge, sizeof(huge));
+    WriteFile(bad_path, data);
+    CHECK(!LoadSceneBinary(bad_path, scene));
+
+    // Enums out of range
+    data = good;
+    int32_t shape = 99;
+    std::memcpy(&data[data.size() - sizeof(SceneBody) + offsetof(SceneBody, Shape)], &shape, sizeof(shape));
+    WriteFile(bad_path, data);
+    CHECK(!LoadSceneBinary(bad_path, scene));
+
+    data = good;
+    shape = SHAPE_PLANE;
+    std::memcpy(&data[data.size() - sizeof(SceneBody) + offsetof(SceneBody, Shape)], &shape, sizeof(shape));
+    WriteFile(bad_path, data);
+    CHECK(!LoadSceneBinary(bad_path, scene));
+
+    data = good;
+    int32_t value = 4;
+    std::memcpy(&data[WORLD_OFFSET + offsetof(SceneWorld, Broadphase)], &value, sizeof(value));
+    WriteFile(bad_path, data);
+    CHECK(!LoadSceneBinary(bad_path, scene));
+
+    data = good;
+    value = -1;
+    std::memcpy(&data[WORLD_OFFSET + offsetof(SceneWorld, IslandThreads)], &value, sizeof(value));
+    WriteFile(bad_path, data);
+    CHECK(!LoadSceneBinary(bad_path, scene));
+
+    // Values ODE would assert on or turn into an invalid mass: a NaN gravity, a material without density, a body
+    // without size
+    data = good;
+    dReal number = std::numeric_limits<dReal>::quiet_NaN();
+    std::memcpy(&data[WORLD_OFFSET + offsetof(SceneWorld, Gravity) + sizeof(dReal)], &number, sizeof(number));
+    WriteFile(bad_path, data);
+    CHECK(!LoadSceneBinary(bad_path, scene));
+
+    data = good;
+    number = 0;
+    std::memcpy(&data[WORLD_OFFSET + sizeof(SceneWorld) + MATERIAL_DENSITY_OFFSET], &number, sizeof(number));
+    WriteFile(bad_path, data);
+    CHECK(!LoadSceneBinary(bad_path, scene));
+
+    data = good;
+    number = -1;
+    std::memcpy(&data[data.size() - sizeof(SceneBody) + offsetof(SceneBody, Size)], &number, sizeof(number));
+    WriteFile(bad_path, data);
+    CHECK(!LoadSceneBinary(bad_path, scene));
+
+    // The untouched file still loads
+    CHECK(LoadSceneBinary(good_path, scene));
+    CHECK(SameScene(scene, MakeScene()));
+
+    std::remove(good_path.c_str());
+    std::remove(bad_path.c_str());
+}
+
+void TestRejectsBadText()
+{
+    std::string path = TempPath("bad.scene");
+    Scene scene;
+
+    const char* bad[] = {
+        "plane 0 1\n",
+        "plane 0 1 0 0 no_such_material\n",
+        "world iterations -3\n",
+        "world island_threads\n",
+        "world broadphase octree\n",
+        "body plane 0 1 0 0 0 0 0 1 0 0 0 0 0 0 0 0 0\n",
+        "static box 1 1 1 0 0 0 1 0 0\n",
+        "sphere 1\n",
+        "body box 1 0 1 0 2 0 1 0 0 0 0 0 0 0 0 0\n",
+        "body sphere -0.5 0 2 0 1 0 0 0 0 0 0 0 0 0\n",
+        "body sphere nan 0 2 0 1 0 0 0 0 0 0 0 0 0\n",
+        "body sphere 0.5 0 2 0 0 0 0 0 0 0 0 0 0 0\n",
+        "body sphere 0.5 0 inf 0 1 0 0 0 0 0 0 0 0 0\n",
+        "static cylinder 1 0 0 0 0 1 0 0 0\n",
+        "material light 0 1 0 0 0\n",
+        "material light -1 1 0 0 0\n",
+        "world gravity 0 nan 0\n",
+        "world erp 2\n",
+        "world cfm -1\n",
+        "plane 0 0 0 1\n",
+    };
+    for(size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i)
+    {
+        WriteText(path, bad[i]);
+        CHECK(!LoadSceneText(path, scene));
+    }
+
+    WriteText(path, "# comment\nworld island_threads 3 broadphase hash\nplane 0 1 0 0\n"
+                    "body sphere 0.5 0 2 0 1 0 0 0 0 0 0 0 0 0");
+    CHECK(LoadSceneText(path, scene));
+    CHECK(scene.World.IslandThreads == 3);
+    CHECK(scene.World.Broadphase == BROADPHASE_HASH);
+    CHECK(scene.Static.size() == 1 && scene.Static[0].Shape == SHAPE_PLANE);
+    CHECK(scene.Bodies.size() == 1 && scene.Bodies[0].Size[0] == 0.5);
+
+    // Out of range values are not written either
+    scene = MakeScene();
+    scene.Bodies[0].Shape = -1;
+    CHECK(!SaveSceneText(path, scene));
+    CHECK(!SaveSceneBinary(path, scene));
+    scene = MakeScene();
+    scene.World.Broadphase = 17;
+    CHECK(!SaveSceneText(path, scene));
+
+    std::remove(path.c_str());
+}
+
+}
+
+int main()
+{
+    dInitODE2(0);
+
+    TestRoundTrip();
+    TestRejectsCorruptBinary();
+    TestRejectsBadText();
+
+    dCloseODE();
+    return TestResult();
+}
@@ -0,0 +1,74 @@
+#include "simulation.h"
+#include "test.h"
+
+namespace
+{
+
+const double DT = 0.01;
+
+void TestRestStep()
+{
+    Simulation sim;
+    InitODE(sim);
+    CHECK(sim.RestStep == NOT_AT_REST);
+
+    uint64_t steps = RunSteps(sim, DT, 100000, REST_STOP);
+    CHECK(sim.RestStep != NOT_AT_REST);
+    CHECK(sim.RestStep == sim.StepCount);
+    CHECK(steps == sim.StepCount);
+    uint64_t rest_step = sim.RestStep;
+    CloseODE(sim);
+
+    // Exactly as many steps as it takes to come to rest: rest is seen after the last step
+    Simulation exact;
+    InitODE(exact);
+    CHECK(RunSteps(exact, DT, rest_step, REST_STOP) == rest_step);
+    CHECK(exact.RestStep == rest_step);
+
+    // Nothing is stepped once at rest, fast forward only moves the step count
+    CHECK(RunSteps(exact, DT, 50, REST_FAST_FORWARD) == 0);
+    CHECK(exact.StepCount == rest_step + 50);
+    CHECK(exact.RestStep == rest_step);
+    CloseODE(exact);
+
+    // One step short is not at rest yet
+    Simulation short_run;
+    InitODE(short_run);
+    RunSteps(short_run, DT, rest_step - 1, REST_STOP);
+    CHECK(short_run.RestStep == NOT_AT_REST);
+    CloseODE(short_run);
+}
+
+void TestRestAtStepZero()
+{
+    Simulation sim;
+    InitODE(sim);
+    dBodyDisable(sim.Objects[0].Body);
+
+    CHECK(RunSteps(sim, DT, 10, REST_STOP) == 0);
+    CHECK(sim.RestStep == 0);
+
+    // Pending input keeps a world awake
+    Simulation woken;
+    InitODE(woken);
+    dBodyDisable(woken.Objects[0].Body);
+    woken.InputPending = true;
+    CHECK(!AtRest(woken));
+
+    CloseODE(woken);
+    CloseODE(sim);
+    CHECK(sim.RestStep == NOT_AT_REST);
+}
+
+}
+
+int main()
+{
+    dInitODE2(0);
+
+    TestRestStep();
+    TestRestAtStepZero();
+
+    dCloseODE();
+    return TestResult();
+}
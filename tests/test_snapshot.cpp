@@ -0,0 +1,153 @@
+#include "snapshot.h"
+#include "test.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+
+const double DT = 0.01;
+
+// Where the file header keeps the version and the rest step, see SnapshotFileHeader
+const long VERSION_OFFSET = 8;
+const long NUM_BODIES_OFFSET = 16;
+const long REST_STEP_OFFSET = 32;
+
+void Pile(Simulation& sim)
+{
+    InitODE(sim);
+    dMatrix3 R;
+    dRFromAxisAndAngle(R, 1, 0, 0, 0.3);
+    for(int i = 0; i < 3; ++i)
+    {
+        dReal pos[3] = { 4.0 * i, 5.0 + i, 2 };
+        dReal sides[3] = { 1, 0.5 + i, 1 };
+        AddBox(sim, pos, sides, R);
+    }
+    TuneSpaces(sim);
+}
+
+// Restored in the air, the worlds go on exactly like the original. Nothing has touched yet, so ODE's solver
+// randomness and the auto disable counters that a snapshot cannot carry play no part.
+void TestRestoreContinuesIdentically()
+{
+    std::string path = TempPath("snapshot.bin");
+
+    Simulation original;
+    Pile(original);
+    for(int step = 0; step < 50; ++step)
+        SimLoop(original, DT);
+    CHECK(SaveSnapshot(path, original));
+
+    Simulation restored;
+    Pile(restored);
+    CHECK(!SameBodies(original, restored));
+    CHECK(LoadSnapshot(path, restored));
+    CHECK(SameBodies(original, restored));
+    CHECK(restored.StepCount == 50);
+    CHECK(restored.RestStep == NOT_AT_REST);
+
+    for(int step = 0; step < 100; ++step)
+    {
+        SimLoop(original, DT);
+        SimLoop(restored, DT);
+    }
+    CHECK(SameBodies(original, restored));
+    CHECK(restored.StepCount == original.StepCount);
+
+    CloseODE(original);
+    CloseODE(restored);
+    std::remove(path.c_str());
+}
+
+void TestRestoreAtRest()
+{
+    std::string path = TempPath("snapshot_rest.bin");
+
+    Simulation settled;
+    Pile(settled);
+    RunSteps(settled, DT, 100000, REST_STOP);
+    CHECK(settled.RestStep != NOT_AT_REST);
+    CHECK(SaveSnapshot(path, settled));
+
+    Simulation restored;
+    Pile(restored);
+    CHECK(LoadSnapshot(path, restored));
+    CHECK(SameBodies(settled, restored));
+    CHECK(restored.RestStep == settled.RestStep);
+    CHECK(AtRest(restored));
+    CHECK(RunSteps(restored, DT, 10, REST_STOP) == 0);
+
+    CloseODE(settled);
+    CloseODE(restored);
+    std::remove(path.c_str());
+}
+
+void TestRejectsBadFiles()
+{
+    std::string path = TempPath("snapshot_bad.bin");
+    std::string bad_path = TempPath("snapshot_corrupt.bin");
+
+    Simulation sim;
+    Pile(sim);
+    CHECK(SaveSnapshot(path, sim));
+    const std::vector<char> good = ReadFile(path);
+
+    // A world with a different number of bodies is left alone
+    Simulation other;
+    InitODE(other);
+    dReal before[3];
+    std::memcpy(before, dBodyGetPosition(other.Objects[0].Body), sizeof(before));
+    CHECK(!LoadSnapshot(path, other));
+    CHECK(SameBits(dBodyGetPosition(other.Objects[0].Body), before, 3));
+    CloseODE(other);
+
+    // Truncated, a body count that would overflow the size check, and no snapshot at all
+    WriteFile(bad_path, std::vector<char>(good.begin(), good.end() - 1));
+    CHECK(!LoadSnapshot(bad_path, sim));
+
+    std::vector<char> data = good;
+    uint64_t huge = ~(uint64_t)0 / 8;
+    std::memcpy(&data[NUM_BODIES_OFFSET], &huge, sizeof(huge));
+    WriteFile(bad_path, data);
+    CHECK(!LoadSnapshot(bad_path, sim));
+
+    WriteFile(bad_path, std::vector<char>(good.size(), 'x'));
+    CHECK(!LoadSnapshot(bad_path, sim));
+    CHECK(!LoadSnapshot(TempPath("does_not_exist.bin"), sim));
+
+    // Another version is refused
+    data = good;
+    uint32_t version = 2;
+    std::memcpy(&data[VERSION_OFFSET], &version, sizeof(version));
+    WriteFile(bad_path, data);
+    CHECK(!LoadSnapshot(bad_path, sim));
+
+    // Rest at step 0 is a rest step like any other
+    data = good;
+    uint64_t rest_step = 0;
+    std::memcpy(&data[REST_STEP_OFFSET], &rest_step, sizeof(rest_step));
+    WriteFile(bad_path, data);
+    sim.RestStep = 5;
+    CHECK(LoadSnapshot(bad_path, sim));
+    CHECK(sim.RestStep == 0);
+
+    CloseODE(sim);
+    std::remove(path.c_str());
+    std::remove(bad_path.c_str());
+}
+
+}
+
+int main()
+{
+    dInitODE2(0);
+
+    TestRestoreContinuesIdentically();
+    TestRestoreAtRest();
+    TestRejectsBadFiles();
+
+    dCloseODE();
+    return TestResult();
+}
@@ -0,0 +1,153 @@
+#include "test.h"
+
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+// No reserve on top of what a step needs, so every growth of the arena shows
+void InitInstrumented(Simulation& sim, StepMemoryStats& stats)
+{
+    sim.StepMemory.ReserveFactor = 1.0f;
+    sim.StepMemory.ReserveMinimum = 0;
+    sim.StepMemory.Instrument = true;
+    sim.MemoryStats = &stats;
+    InitODE(sim);
+}
+
+// High enough above the ground that nothing touches during the test
+void AddBoxes(Simulation& sim, int n)
+{
+    dReal sides[3] = { 1, 1, 1 };
+    dMatrix3 R;
+    dRSetIdentity(R);
+    for(int i = 0; i < n; ++i)
+    {
+        dReal pos[3] = { (dReal)(3 * i), 50, 5 };
+        AddBox(sim, pos, sides, R);
+    }
+}
+
+bool OnlySteps(const StepMemoryStats& stats, uint64_t a, uint64_t b)
+{
+    bool seen_a = false;
+    bool seen_b = false;
+    for(size_t i = 0; i < stats.AllocationSteps.size(); ++i)
+    {
+        seen_a |= stats.AllocationSteps[i] == a;
+        seen_b |= stats.AllocationSteps[i] == b;
+        if (stats.AllocationSteps[i] != a && stats.AllocationSteps[i] != b)
+            return false;
+    }
+    return seen_a && seen_b;
+}
+
+// Each world counts its own arenas, including the step that had to grow them
+void TestPerWorld()
+{
+    StepMemoryStats stats_a, stats_b;
+    Simulation a, b;
+    InitInstrumented(a, stats_a);
+    InitInstrumented(b, stats_b);
+
+    for(int step = 0; step < 10; ++step)
+    {
+        if (step == 5)
+            AddBoxes(a, 20);
+        SimLoop(a, 0.01);
+    }
+
+    CHECK(OnlySteps(stats_a, 0, 5));
+    CHECK(stats_a.Allocations == stats_a.AllocationSteps.size());
+    CHECK(stats_a.Frees > 0 && stats_a.ArenaBytes > 0 && stats_a.LargestArena > 0);
+
+    // b has not stepped yet
+    CHECK(stats_b.Allocations == 0 && stats_b.ArenaBytes == 0 && stats_b.AllocationSteps.empty());
+
+    // Learning the arena size of b neither shows in its own stats nor touches those of a
+    StepMemoryStats before = stats_a;
+    SimLoop(b, 0.01);
+    CHECK(stats_b.Allocations == 1 && stats_b.AllocationSteps[0] == 0);
+    unsigned reserve = LearnStepMemory(b, 0.01, 20);
+    CHECK(reserve >= stats_b.LargestArena);
+    CHECK(stats_b.Allocations == 1 && stats_b.Frees == 1 && stats_b.ArenaBytes == 0);
+    CHECK(stats_a.Allocations == before.Allocations && stats_a.ArenaBytes == before.ArenaBytes &&
+          stats_a.LargestArena == before.LargestArena && stats_a.AllocationSteps == before.AllocationSteps);
+
+    // Arenas freed outside of a step are still taken off the right world
+    CloseODE(a);
+    CHECK(stats_a.ArenaBytes == 0 && stats_a.Frees == stats_a.Allocations);
+    CloseODE(b);
+
+    // Clearing the counts keeps the level
+    ResetStepMemoryStats(before);
+    CHECK(before.Allocations == 0 && before.LargestArena == 0 && before.AllocationSteps.empty());
+    CHECK(before.ArenaBytes > 0);
+}
+
+// Worlds stepped on several threads at once count the same as when stepped one after the other
+void TestConcurrentWorlds()
+{
+    const int NUM_WORLDS = 4;
+    std::vector<StepMemoryStats> serial(NUM_WORLDS), parallel(NUM_WORLDS);
+    std::vector<Simulation> serial_sims(NUM_WORLDS), parallel_sims(NUM_WORLDS);
+
+    for(int w = 0; w < NUM_WORLDS; ++w)
+    {
+        InitInstrumented(serial_sims[w], serial[w]);
+        InitInstrumented(parallel_sims[w], parallel[w]);
+    }
+
+    // World w grows at step 10 * (w + 1)
+    struct Run
+    {
+        static void Steps(Simulation& sim, int w)
+        {
+            for(int step = 0; step < 50; ++step)
+            {
+                if (step == 10 * (w + 1))
+                    AddBoxes(sim, 10 * (w + 1));
+                SimLoop(sim, 0.01);
+            }
+        }
+    };
+
+    for(int w = 0; w < NUM_WORLDS; ++w)
+        Run::Steps(serial_sims[w], w);
+
+    std::vector<std::thread> threads;
+    for(int w = 0; w < NUM_WORLDS; ++w)
+        threads.push_back(std::thread([&parallel_sims, w]() { Run::Steps(parallel_sims[w], w); }));
+    for(size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+
+    for(int w = 0; w < NUM_WORLDS; ++w)
+    {
+        CHECK(OnlySteps(parallel[w], 0, 10 * (w + 1)));
+        CHECK(parallel[w].AllocationSteps == serial[w].AllocationSteps);
+        CHECK(parallel[w].LargestArena == serial[w].LargestArena);
+        CHECK(parallel[w].ArenaBytes == serial[w].ArenaBytes);
+        if (w > 0)
+            CHECK(parallel[w].LargestArena > parallel[w - 1].LargestArena);
+    }
+
+    for(int w = 0; w < NUM_WORLDS; ++w)
+    {
+        CloseODE(serial_sims[w]);
+        CloseODE(parallel_sims[w]);
+    }
+}
+
+}
+
+int main()
+{
+    dInitODE2(0);
+
+    TestPerWorld();
+    TestConcurrentWorlds();
+
+    dCloseODE();
+    return TestResult();
+}
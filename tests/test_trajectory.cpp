@@ -0,0 +1,152 @@
+#include "test.h"
+#include "trajectory.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+
+const unsigned NUM_BODIES = 3;
+
+// Distinct values for every field of every record, so a mixed up offset shows
+void MakeFrame(uint64_t frame, TrajectorySample* samples)
+{
+    for(unsigned b = 0; b < NUM_BODIES; ++b)
+    {
+        TrajectorySample& s = samples[b];
+        s.Step = 2 * frame;
+        s.Body = b;
+        double base = frame * 100.0 + b * 10.0;
+        for(int k = 0; k < 3; ++k)
+        {
+            s.Position[k] = base + k;
+            s.LinearVel[k] = -(base + k);
+            s.AngularVel[k] = base + k + 0.5;
+        }
+        for(int k = 0; k < 4; ++k)
+            s.Quaternion[k] = base + k + 0.25;
+    }
+}
+
+void TestRoundTrip()
+{
+    std::string path = TempPath("trajectory.bin");
+
+    TrajectoryWriter writer;
+    CHECK(writer.NumFrames() == 0);
+    CHECK(writer.Open(path, TRAJ_ALL, NUM_BODIES));
+
+    // Enough frames to need several mapped chunks
+    const uint64_t num_frames = 50000;
+    TrajectorySample samples[NUM_BODIES];
+    for(uint64_t f = 0; f < num_frames; ++f)
+    {
+        MakeFrame(f, samples);
+        CHECK(writer.Record(samples, NUM_BODIES));
+    }
+    CHECK(writer.NumFrames() == num_frames);
+
+    // A frame of the wrong size is refused
+    CHECK(!writer.Record(samples, NUM_BODIES - 1));
+    writer.Close();
+
+    TrajectoryReader reader;
+    CHECK(reader.Open(path));
+    CHECK(reader.Fields() == TRAJ_ALL);
+    CHECK(reader.NumBodies() == NUM_BODIES);
+    CHECK(reader.NumFrames() == num_frames);
+
+    // Including the frames on both sides of the first chunk boundaries with 4 KiB pages
+    const uint64_t frames[] = { 0, 1, 21845, 21846, 43690, num_frames - 1 };
+    for(size_t i = 0; i < sizeof(frames) / sizeof(frames[0]); ++i)
+    {
+        MakeFrame(frames[i], samples);
+        for(unsigned b = 0; b < NUM_BODIES; ++b)
+        {
+            TrajectorySample s;
+            CHECK(reader.Read(frames[i], b, s));
+            CHECK(s.Step == samples[b].Step);
+            CHECK(s.Body == b);
+            CHECK(SameBits(s.Position, samples[b].Position, 3));
+            CHECK(SameBits(s.Quaternion, samples[b].Quaternion, 4));
+            CHECK(SameBits(s.LinearVel, samples[b].LinearVel, 3));
+            CHECK(SameBits(s.AngularVel, samples[b].AngularVel, 3));
+        }
+    }
+
+    TrajectorySample s;
+    CHECK(!reader.Read(num_frames, 0, s));
+    CHECK(!reader.Read(0, NUM_BODIES, s));
+
+    // Steps are even, an odd step finds the frame after it
+    CHECK(reader.FindStep(0) == 0);
+    CHECK(reader.FindStep(2000) == 1000);
+    CHECK(reader.FindStep(2001) == 1001);
+    CHECK(reader.FindStep(2 * num_frames) == num_frames);
+
+    reader.Close();
+    std::remove(path.c_str());
+}
+
+void TestFieldSubset()
+{
+    std::string path = TempPath("trajectory_subset.bin");
+
+    TrajectoryWriter writer;
+    CHECK(writer.Open(path, TRAJ_POSITION | TRAJ_ANGULAR_VEL, NUM_BODIES));
+    TrajectorySample samples[NUM_BODIES];
+    for(uint64_t f = 0; f < 10; ++f)
+    {
+        MakeFrame(f, samples);
+        CHECK(writer.Record(samples, NUM_BODIES));
+    }
+    writer.Close();
+
+    TrajectoryReader reader;
+    CHECK(reader.Open(path));
+    CHECK(reader.Fields() == (TRAJ_POSITION | TRAJ_ANGULAR_VEL));
+
+    TrajectorySample s;
+    CHECK(reader.Read(7, 2, s));
+    MakeFrame(7, samples);
+    const dReal zero[4] = { 0, 0, 0, 0 };
+    CHECK(SameBits(s.Position, samples[2].Position, 3));
+    CHECK(SameBits(s.AngularVel, samples[2].AngularVel, 3));
+    CHECK(SameBits(s.Quaternion, zero, 4));
+    CHECK(SameBits(s.LinearVel, zero, 3));
+
+    reader.Close();
+    std::remove(path.c_str());
+}
+
+void TestRejectsBadFiles()
+{
+    TrajectoryWriter writer;
+    CHECK(!writer.Open(TempPath("empty_world.bin"), TRAJ_ALL, 0));
+    CHECK(writer.NumFrames() == 0);
+
+    std::string path = TempPath("not_a_trajectory.bin");
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    std::vector<char> junk(8192, 'x');
+    std::fwrite(&junk[0], 1, junk.size(), f);
+    std::fclose(f);
+
+    TrajectoryReader reader;
+    CHECK(!reader.Open(path));
+    CHECK(reader.NumFrames() == 0);
+    CHECK(!reader.Open(TempPath("does_not_exist.bin")));
+
+    std::remove(path.c_str());
+}
+
+}
+
+int main()
+{
+    TestRoundTrip();
+    TestFieldSubset();
+    TestRejectsBadFiles();
+
+    return TestResult();
+}
@@ -0,0 +1,113 @@
+#include "test.h"
+#include "vector_env.h"
+
+#include <vector>
+
+namespace
+{
+
+const size_t NUM_WORLDS = 8;
+const int OBS = VectorEnv::OBSERVATION_SIZE;
+
+VectorEnvConfig Config(unsigned threads)
+{
+    VectorEnvConfig config;
+    config.NumWorlds = NUM_WORLDS;
+    config.NumThreads = threads;
+    config.MaxEpisodeSteps = 50;
+    config.RunId = 3;
+    return config;
+}
+
+bool SameFloats(const float* a, const float* b, size_t n)
+{
+    return std::memcmp(a, b, n * sizeof(float)) == 0;
+}
+
+void TestEpisodes()
+{
+    VectorEnv env(Config(2));
+    CHECK(env.NumWorlds() == NUM_WORLDS);
+
+    env.Reset();
+    std::vector<float> first(env.Observations(), env.Observations() + NUM_WORLDS * OBS);
+    for(size_t i = 0; i < NUM_WORLDS; ++i)
+    {
+        // Dropped from (0, 10, -5) at rest, every world with its own orientation
+        const float* o = &first[i * OBS];
+        CHECK(o[0] == 0 && o[1] == 10 && o[2] == -5);
+        CHECK(o[7] == 0 && o[8] == 0 && o[9] == 0);
+        CHECK(env.EpisodeSteps()[i] == 0);
+        if (i > 0)
+            CHECK(!SameFloats(o + 3, &first[(i - 1) * OBS + 3], 4));
+    }
+
+    // Push world 3 along x, leave the others alone
+    std::vector<float> actions(NUM_WORLDS * VectorEnv::ACTION_SIZE, 0.0f);
+    actions[3 * VectorEnv::ACTION_SIZE] = 1.0f;
+
+    for(int step = 1; step < 50; ++step)
+    {
+        env.Step(&actions[0]);
+        for(size_t i = 0; i < NUM_WORLDS; ++i)
+        {
+            CHECK(!env.Dones()[i]);
+            CHECK(env.EpisodeSteps()[i] == (uint32_t)step);
+        }
+    }
+
+    const float* o = env.Observations();
+    CHECK(o[3 * OBS + 0] > 0 && o[3 * OBS + 7] > 0);
+    CHECK(env.Rewards()[3] < 0);
+    CHECK(o[0] == 0 && o[7] == 0 && o[8] < 0);
+    CHECK(env.Rewards()[0] == 0);
+
+    // The 50th step ends every episode, the observations are the first ones of the next episode
+    env.Step(&actions[0]);
+    for(size_t i = 0; i < NUM_WORLDS; ++i)
+    {
+        CHECK(env.Dones()[i]);
+        CHECK(env.EpisodeSteps()[i] == 0);
+    }
+    CHECK(SameFloats(env.Observations(), &first[0], first.size()));
+
+    env.Step(&actions[0]);
+    CHECK(!env.Dones()[0]);
+    CHECK(env.EpisodeSteps()[0] == 1);
+}
+
+// Nothing touches anything in the first steps, so ODE's solver has no contacts to shuffle and the worlds only depend
+// on their own actions
+void TestDoesNotDependOnThreads()
+{
+    VectorEnv serial(Config(1));
+    VectorEnv parallel(Config(4));
+    serial.Reset();
+    parallel.Reset();
+
+    std::vector<float> actions(NUM_WORLDS * VectorEnv::ACTION_SIZE);
+    for(int step = 0; step < 40; ++step)
+    {
+        for(size_t k = 0; k < actions.size(); ++k)
+            actions[k] = (float)(((step * 7 + k * 13) % 11) - 5) / 5.0f;
+
+        serial.Step(&actions[0]);
+        parallel.Step(&actions[0]);
+    }
+
+    CHECK(SameFloats(serial.Observations(), parallel.Observations(), NUM_WORLDS * OBS));
+    CHECK(SameFloats(serial.Rewards(), parallel.Rewards(), NUM_WORLDS));
+}
+
+}
+
+int main()
+{
+    dInitODE2(0);
+
+    TestEpisodes();
+    TestDoesNotDependOnThreads();
+
+    dCloseODE();
+    return TestResult();
+}
@@ -0,0 +1,183 @@
+#include "test.h"
+#include "world_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const uint64_t RUN_ID = 5;
+
+// Bodies, force accumulators and episode counters
+bool SameAsFresh(const Simulation& a, const Simulation& b)
+{
+    if (!SameBodies(a, b))
+        return false;
+
+    for(size_t i = 0; i < a.Objects.size(); ++i)
+    {
+        if (!SameBits(dBodyGetForce(a.Objects[i].Body), dBodyGetForce(b.Objects[i].Body), 3))
+            return false;
+    }
+    return a.StepCount == b.StepCount && a.RestStep == b.RestStep && a.InputPending == b.InputPending;
+}
+
+// Which of the freshly built worlds 'sim' is, or -1
+int FindFresh(const Simulation& sim, const std::vector<Simulation>& fresh)
+{
+    for(size_t i = 0; i < fresh.size(); ++i)
+    {
+        if (SameAsFresh(sim, fresh[i]))
+            return (int)i;
+    }
+    return -1;
+}
+
+void TestResetEqualsFreshWorld()
+{
+    WorldPool pool(3, WorldPool::Builder(), RUN_ID);
+    CHECK(pool.Size() == 3);
+    CHECK(pool.Available() == 3);
+
+    std::vector<Simulation> fresh(3);
+    for(size_t i = 0; i < fresh.size(); ++i)
+    {
+        fresh[i].Random = RandomStream(RUN_ID, i);
+        InitODE(fresh[i]);
+    }
+
+    Simulation* sim = pool.Acquire();
+    CHECK(pool.Available() == 2);
+    int which = FindFresh(*sim, fresh);
+    CHECK(which >= 0);
+
+    // A whole episode: land, come to rest, and be left with input pending
+    RunSteps(*sim, 0.01, 100000, REST_STOP);
+    CHECK(sim->RestStep != NOT_AT_REST);
+    dBodyEnable(sim->Objects[0].Body);
+    dBodyAddForce(sim->Objects[0].Body, 1, 2, 3);
+    sim->InputPending = true;
+
+    pool.Release(sim);
+    CHECK(pool.Available() == 3);
+
+    Simulation* again = pool.Acquire();
+    CHECK(again == sim);
+    if (which < 0)
+        return;
+    CHECK(SameAsFresh(*again, fresh[which]));
+
+    // And runs like one, as long as nothing touches (ODE's solver randomness is shared by all worlds)
+    for(int step = 0; step < 100; ++step)
+    {
+        SimLoop(*again, 0.01);
+        SimLoop(fresh[which], 0.01);
+    }
+    CHECK(SameAsFresh(*again, fresh[which]));
+
+    pool.Release(again);
+    for(size_t i = 0; i < fresh.size(); ++i)
+        CloseODE(fresh[i]);
+}
+
+void TestGrows()
+{
+    size_t built = 0;
+    WorldPool pool(1, [&built](Simulation& sim) { InitODE(sim); ++built; });
+    CHECK(built == 1);
+
+    Simulation* a = pool.Acquire();
+    Simulation* b = pool.Acquire();
+    CHECK(a != b);
+    CHECK(built == 2);
+    CHECK(pool.Size() == 2);
+    CHECK(pool.Available() == 0);
+
+    pool.Release(a);
+    pool.Release(b);
+    CHECK(pool.Available() == 2);
+}
+
+// Threads that find the pool empty build their worlds at the same time, each with its own random stream
+void TestGrowsOnSeveralThreads()
+{
+    std::mutex mutex;
+    int building = 0;
+    int most_building = 0;
+    WorldPool pool(0, [&mutex, &building, &most_building](Simulation& sim)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            most_building = std::max(most_building, ++building);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        InitODE(sim);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        --building;
+    }, RUN_ID);
+
+    std::vector<Simulation*> worlds(4);
+    std::vector<std::thread> threads;
+    for(size_t t = 0; t < worlds.size(); ++t)
+        threads.push_back(std::thread([&pool, &worlds, t]() { worlds[t] = pool.Acquire(); }));
+    for(size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+
+    CHECK(most_building > 1);
+    CHECK(pool.Size() == worlds.size());
+    for(size_t t = 0; t < worlds.size(); ++t)
+    {
+        for(size_t u = 0; u < t; ++u)
+            CHECK(!SameBits(dBodyGetQuaternion(worlds[t]->Objects[0].Body),
+                            dBodyGetQuaternion(worlds[u]->Objects[0].Body), 4));
+    }
+
+    for(size_t t = 0; t < worlds.size(); ++t)
+        pool.Release(worlds[t]);
+    CHECK(pool.Available() == worlds.size());
+}
+
+void TestConcurrentUse()
+{
+    WorldPool pool(4);
+
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; ++t)
+    {
+        threads.push_back(std::thread([&pool]()
+        {
+            for(int episode = 0; episode < 20; ++episode)
+            {
+                Simulation* sim = pool.Acquire();
+                for(int step = 0; step < 5; ++step)
+                    SimLoop(*sim, 0.01);
+                pool.Release(sim);
+            }
+        }));
+    }
+    for(size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+
+    CHECK(pool.Size() >= 4);
+    CHECK(pool.Available() == pool.Size());
+}
+
+}
+
+int main()
+{
+    dInitODE2(0);
+
+    TestResetEqualsFreshWorld();
+    TestGrows();
+    TestGrowsOnSeveralThreads();
+    TestConcurrentUse();
+
+    dCloseODE();
+    return TestResult();
+}
@@ -0,0 +1,196 @@
+#include "test.h"
+#include "thread_pool.h"
+#include "world_template.h"
+
+#include <vector>
+
+namespace
+{
+
+const double DT = 0.01;
+
+// The example scene, another box and a body made of a sphere with an offset and a capsule, with settings that are
+// not the defaults
+void BuildSource(Simulation& sim)
+{
+    sim.Random = RandomStream(7, 2);
+    InitODE(sim);
+
+    dReal pos[3] = { 4, 6, 1 };
+    dReal sides[3] = { 0.5, 1, 2 };
+    dMatrix3 R;
+    dRFromAxisAndAngle(R, 0, 1, 1, 0.4);
+    size_t b = AddBox(sim, pos, sides, R);
+    dBodySetLinearVel(sim.Objects[b].Body, 1, 0.5, -2);
+    dBodySetAngularVel(sim.Objects[b].Body, 0.2, -0.1, 0.3);
+
+    MyObject object = MyObject();
+    object.Body = dBodyCreate(sim.World);
+    dBodySetPosition(object.Body, -3, 8, 2);
+    dMass m;
+    dMassSetSphere(&m, 2.0, 0.4);
+    dBodySetMass(object.Body, &m);
+    object.Geom[0] = dCreateSphere(sim.Space, 0.4);
+    dGeomSetBody(object.Geom[0], object.Body);
+    dGeomSetOffsetPosition(object.Geom[0], 0.1, 0.2, -0.3);
+    // More geoms than MyObject keeps, the body still has it
+    dGeomID capsule = dCreateCapsule(sim.Space, 0.2, 1.5);
+    dGeomSetBody(capsule, object.Body);
+    dGeomSetCategoryBits(capsule, 6);
+    dGeomSetCollideBits(capsule, 3);
+    dBodySetData(object.Body, (void*)sim.Objects.size());
+    dBodySetGravityMode(object.Body, 0);
+    dBodySetAutoDisableSteps(object.Body, 33);
+    sim.Objects.push_back(object);
+
+    AddPlane(sim, 1, 0, 0, -20);
+
+    dWorldSetGravity(sim.World, 0.5, -3, 0);
+    dWorldSetERP(sim.World, 0.3);
+    dWorldSetCFM(sim.World, 2e-5);
+    dWorldSetQuickStepNumIterations(sim.World, 13);
+    dWorldSetAutoDisableTime(sim.World, 0.25);
+}
+
+bool SameGeom(dGeomID a, dGeomID b)
+{
+    int c = dGeomGetClass(a);
+    if (c != dGeomGetClass(b) || GetGeomMaterial(a) != GetGeomMaterial(b) ||
+        dGeomGetCategoryBits(a) != dGeomGetCategoryBits(b) || dGeomGetCollideBits(a) != dGeomGetCollideBits(b))
+        return false;
+
+    dReal pa[4] = { 0, 0, 0, 0 };
+    dReal pb[4] = { 0, 0, 0, 0 };
+    switch (c)
+    {
+    case dSphereClass: pa[0] = dGeomSphereGetRadius(a); pb[0] = dGeomSphereGetRadius(b); break;
+    case dBoxClass: dGeomBoxGetLengths(a, pa); dGeomBoxGetLengths(b, pb); break;
+    case dCapsuleClass: dGeomCapsuleGetParams(a, &pa[0], &pa[1]); dGeomCapsuleGetParams(b, &pb[0], &pb[1]); break;
+    case dPlaneClass: dGeomPlaneGetParams(a, pa); dGeomPlaneGetParams(b, pb); return SameBits(pa, pb, 4);
+    }
+    if (!SameBits(pa, pb, 4))
+        return false;
+
+    if (!dGeomGetBody(a))
+        return SameBits(dGeomGetPosition(a), dGeomGetPosition(b), 3);
+    return SameBits(dGeomGetPosition(a), dGeomGetPosition(b), 3) &&
+           SameBits(dGeomGetRotation(a), dGeomGetRotation(b), 12) &&
+           dGeomIsOffset(a) == dGeomIsOffset(b);
+}
+
+bool SameWorld(const Simulation& a, const Simulation& b)
+{
+    dVector3 ga, gb;
+    dWorldGetGravity(a.World, ga);
+    dWorldGetGravity(b.World, gb);
+    if (!SameBits(ga, gb, 3) || dWorldGetERP(a.World) != dWorldGetERP(b.World) ||
+        dWorldGetCFM(a.World) != dWorldGetCFM(b.World) ||
+        dWorldGetQuickStepNumIterations(a.World) != dWorldGetQuickStepNumIterations(b.World) ||
+        dWorldGetAutoDisableTime(a.World) != dWorldGetAutoDisableTime(b.World) ||
+        a.Broadphase.Type != b.Broadphase.Type || a.Objects.size() != b.Objects.size())
+        return false;
+
+    for(size_t i = 0; i < a.Objects.size(); ++i)
+    {
+        dBodyID ba = a.Objects[i].Body;
+        dBodyID bb = b.Objects[i].Body;
+        dMass ma, mb;
+        dBodyGetMass(ba, &ma);
+        dBodyGetMass(bb, &mb);
+        if (!SameBits(dBodyGetPosition(ba), dBodyGetPosition(bb), 3) ||
+            !SameBits(dBodyGetQuaternion(ba), dBodyGetQuaternion(bb), 4) ||
+            !SameBits(dBodyGetLinearVel(ba), dBodyGetLinearVel(bb), 3) ||
+            !SameBits(dBodyGetAngularVel(ba), dBodyGetAngularVel(bb), 3) ||
+            !SameBits(&ma.mass, &mb.mass, 1) || !SameBits(ma.c, mb.c, 3) || !SameBits(ma.I, mb.I, 12) ||
+            dBodyIsEnabled(ba) != dBodyIsEnabled(bb) || dBodyGetGravityMode(ba) != dBodyGetGravityMode(bb) ||
+            dBodyGetAutoDisableSteps(ba) != dBodyGetAutoDisableSteps(bb) || dBodyGetData(bb) != (void*)i)
+            return false;
+
+        dGeomID ga = dBodyGetFirstGeom(ba);
+        dGeomID gb = dBodyGetFirstGeom(bb);
+        for(; ga && gb; ga = dBodyGetNextGeom(ga), gb = dBodyGetNextGeom(gb))
+        {
+            if (!SameGeom(ga, gb))
+                return false;
+        }
+        if (ga || gb)
+            return false;
+    }
+
+    int num_static = dSpaceGetNumGeoms(a.StaticSpace);
+    if (num_static != dSpaceGetNumGeoms(b.StaticSpace))
+        return false;
+    for(int i = 0; i < num_static; ++i)
+    {
+        if (!SameGeom(dSpaceGetGeom(a.StaticSpace, i), dSpaceGetGeom(b.StaticSpace, i)))
+            return false;
+    }
+    return dSpaceGetNumGeoms(a.Space) == dSpaceGetNumGeoms(b.Space);
+}
+
+void TestInstantiate()
+{
+    Simulation source;
+    BuildSource(source);
+    dBodyDisable(source.Objects[1].Body);
+
+    WorldTemplate tmpl(source);
+    CHECK(tmpl.NumBodies() == 3);
+
+    Simulation clone;
+    tmpl.Instantiate(clone);
+    CHECK(SameWorld(source, clone));
+    CHECK(clone.Objects[2].Geom[0] == dBodyGetFirstGeom(clone.Objects[2].Body));
+
+    // The source can go, the clone does not use any of it
+    CloseODE(source);
+    Simulation again;
+    tmpl.Instantiate(again);
+    CHECK(SameWorld(clone, again));
+
+    CloseODE(clone);
+    CloseODE(again);
+}
+
+void TestCloneWorlds()
+{
+    Simulation source;
+    BuildSource(source);
+    WorldTemplate tmpl(source);
+
+    ThreadPool pool(4);
+    std::vector<Simulation> worlds(9);
+    CloneWorlds(tmpl, worlds, pool);
+    for(size_t i = 0; i < worlds.size(); ++i)
+        CHECK(SameWorld(source, worlds[i]));
+
+    // Nothing touches anything yet, so ODE's solver has no contacts to shuffle and every clone moves like the source
+    for(int step = 0; step < 50; ++step)
+    {
+        SimLoop(source, DT);
+        for(size_t i = 0; i < worlds.size(); ++i)
+            SimLoop(worlds[i], DT);
+    }
+    for(size_t i = 0; i < worlds.size(); ++i)
+    {
+        CHECK(worlds[i].StepCount == 50);
+        CHECK(SameWorld(source, worlds[i]));
+    }
+
+    for(size_t i = 0; i < worlds.size(); ++i)
+        CloseODE(worlds[i]);
+    CloseODE(source);
+}
+
+}
+
+int main()
+{
+    dInitODE2(0);
+
+    TestInstantiate();
+    TestCloneWorlds();
+
+    dCloseODE();
+    return TestResult();
+}